@@ -0,0 +1,244 @@
+#include <benchmark/benchmark.h>
+#include <cstdio>
+
+#include "Particle_Simulation.h"
+#include "Asteroid_Field.h"
+#include "Object_Geometry.h"
+#include "Solar_System.h"
+#include "Light_Clusters.h"
+#include "Mip_Downsample.h"
+
+//CPU hot paths only, these headers include no GL, GLFW or assimp so the binary links nothing but the benchmark library.
+//Fixtures are seeded so runs are comparable.
+
+//-------------------- Particles
+static void BM_EmitParticles(benchmark::State& state)
+{
+	unsigned int particle_total = (unsigned int)state.range(0);
+
+	ParticleSimulation emitter;
+	emitter.Configure(particle_total, std::max(1u, particle_total / 50), 60, 0.5f, 2.f, 1);
+
+	const double dt = 1.0 / 120.0;
+	glm::vec3 origin(0.f);
+	glm::vec3 velocity(0.f, 0.f, -1.f);
+	for (int i = 0; i < 240; i++) { emitter.emitParticles(dt, origin, velocity); } //Warm up to a steady particle count
+
+	for (auto _ : state)
+	{
+		origin.z += 0.01f;
+		emitter.emitParticles(dt, origin, velocity);
+	}
+	state.SetItemsProcessed(state.iterations() * particle_total);
+}
+BENCHMARK(BM_EmitParticles)->Arg(100)->Arg(1000)->Arg(10000)->Arg(100000);
+
+static void BM_SortParticles(benchmark::State& state)
+{ //Back to front sort of a moving trail seen by a slowly orbiting camera, the incremental case
+	unsigned int particle_total = (unsigned int)state.range(0);
+
+	ParticleSimulation emitter;
+	emitter.Configure(particle_total, std::max(1u, particle_total / 50), 60, 0.5f, 2.f, 1);
+	emitter.setBlending(ParticleSimulation::SORTED);
+
+	const double dt = 1.0 / 120.0;
+	glm::vec3 origin(0.f);
+	glm::vec3 velocity(0.f, 0.f, -1.f);
+	float angle = 0.f;
+	for (int i = 0; i < 240; i++) { emitter.emitParticles(dt, origin, velocity); }
+	emitter.SortParticles(glm::lookAt(glm::vec3(0.f, 2.f, 10.f), origin, glm::vec3(0.f, 1.f, 0.f)));
+
+	int64_t incremental = 0;
+	for (auto _ : state)
+	{
+		state.PauseTiming();
+		origin.z += 0.01f;
+		angle += 0.002f;
+		emitter.emitParticles(dt, origin, velocity);
+		glm::mat4 view = glm::lookAt(origin + glm::vec3(10.f * sin(angle), 2.f, 10.f * cos(angle)), origin, glm::vec3(0.f, 1.f, 0.f));
+		state.ResumeTiming();
+
+		emitter.SortParticles(view);
+		incremental += emitter.wasSortIncremental() ? 1 : 0;
+	}
+	state.SetItemsProcessed(state.iterations() * particle_total);
+	state.counters["incremental"] = benchmark::Counter((double)incremental, benchmark::Counter::kAvgIterations);
+}
+BENCHMARK(BM_SortParticles)->Arg(100000)->Arg(300000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+
+static void BM_RadixSortParticles(benchmark::State& state)
+{ //The fallback after a camera cut, every key in random order
+	size_t count = (size_t)state.range(0);
+	std::minstd_rand generator(1);
+	std::uniform_real_distribution<float> depth(0.1f, 500.f);
+	std::vector<uint64_t> shuffled(count), entries, scratch;
+	for (size_t i = 0; i < count; i++)
+	{
+		float key_depth = depth(generator);
+		uint32_t bits;
+		memcpy(&bits, &key_depth, sizeof(bits));
+		shuffled[i] = (uint64_t)~(bits | 0x80000000u) << 32 | i;
+	}
+
+	for (auto _ : state)
+	{
+		entries = shuffled;
+		ParticleSimulation::RadixSort(entries, scratch);
+		benchmark::DoNotOptimize(entries.data());
+	}
+	state.SetItemsProcessed(state.iterations() * count);
+}
+BENCHMARK(BM_RadixSortParticles)->Arg(100000)->Arg(300000)->Arg(1000000)->Unit(benchmark::kMicrosecond);
+
+//-------------------- Asteroid Belts
+static void BM_GenerateAsteroidOrbits(benchmark::State& state)
+{
+	unsigned int amount = (unsigned int)state.range(0);
+	for (auto _ : state)
+	{
+		std::vector<Orbit_Instance> orbits = generateAsteroidOrbits(amount, 15.f, 125.f, 1);
+		benchmark::DoNotOptimize(orbits.data());
+	}
+	state.SetItemsProcessed(state.iterations() * amount);
+}
+BENCHMARK(BM_GenerateAsteroidOrbits)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond);
+
+static void BM_GenerateAsteroidOrbitsParallel(benchmark::State& state)
+{
+	unsigned int amount = (unsigned int)state.range(0);
+	JobSystem jobs;
+	jobs.Initialize();
+
+	for (auto _ : state)
+	{
+		jobs.BeginFrame();
+		std::vector<Orbit_Instance> orbits = generateAsteroidOrbits(amount, 15.f, 125.f, 1, &jobs);
+		benchmark::DoNotOptimize(orbits.data());
+	}
+	state.SetItemsProcessed(state.iterations() * amount);
+}
+BENCHMARK(BM_GenerateAsteroidOrbitsParallel)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond);
+
+static void BM_ChunkAsteroidOrbits(benchmark::State& state)
+{ //Startup cost of sorting a belt into chunks
+	unsigned int amount = (unsigned int)state.range(0);
+	std::vector<Orbit_Instance> generated = generateAsteroidOrbits(amount, 30.f, 225.f, 1);
+
+	for (auto _ : state)
+	{
+		std::vector<Orbit_Instance> orbits = generated;
+		std::vector<Asteroid_Chunk> chunks = chunkAsteroidOrbits(orbits);
+		benchmark::DoNotOptimize(chunks.data());
+	}
+	state.SetItemsProcessed(state.iterations() * amount);
+}
+BENCHMARK(BM_ChunkAsteroidOrbits)->RangeMultiplier(10)->Range(1000, 1000000)->Unit(benchmark::kMicrosecond);
+
+//-------------------- Object Text Parsing
+static void BM_ObjectLoadModel(benchmark::State& state)
+{
+	//Writes a sphere out in the object text format once, then times parsing it back
+	ObjectGeometry sphere;
+	sphere.generateSphere((int)state.range(0));
+
+	std::string file_path = "benchmark_object_" + std::to_string(state.range(0)) + ".txt";
+	{
+		std::ofstream object_file(file_path);
+		for (const ObjectGeometry::Vertex& vertex : sphere.Vertices)
+		{
+			object_file << "V " << vertex.vertex.x << " " << vertex.vertex.y << " " << vertex.vertex.z << " "
+				<< vertex.normal.x << " " << vertex.normal.y << " " << vertex.normal.z << " "
+				<< vertex.texture_coords.x << " " << vertex.texture_coords.y << "\n";
+		}
+		for (unsigned int i = 0; i < sphere.Indices.size(); i += 3)
+		{
+			object_file << "I " << sphere.Indices[i] + 1 << " " << sphere.Indices[i + 1] + 1 << " " << sphere.Indices[i + 2] + 1 << "\n";
+		}
+	}
+
+	for (auto _ : state)
+	{
+		ObjectGeometry object;
+		object.loadModel(file_path.c_str());
+		benchmark::DoNotOptimize(object.Vertices.data());
+	}
+	state.SetItemsProcessed(state.iterations() * sphere.Vertices.size());
+	remove(file_path.c_str());
+}
+BENCHMARK(BM_ObjectLoadModel)->Arg(20)->Arg(100)->Arg(300)->Unit(benchmark::kMicrosecond);
+
+//-------------------- Sphere Generation
+static void BM_SphereGenerate(benchmark::State& state)
+{
+	int precision = (int)state.range(0);
+	ObjectGeometry sphere;
+	for (auto _ : state)
+	{
+		sphere.generateSphere(precision);
+		benchmark::DoNotOptimize(sphere.Vertices.data());
+	}
+	state.SetItemsProcessed(state.iterations() * sphere.Vertices.size());
+}
+BENCHMARK(BM_SphereGenerate)->Arg(20)->Arg(50)->Arg(100)->Arg(200);
+
+//-------------------- Solar System Transforms
+static void BM_SolarSystemTransforms(benchmark::State& state)
+{
+	std::stack<std::pair<std::string, glm::mat4>> planet_stack;
+	double elapsed_time = 0.0;
+
+	for (auto _ : state)
+	{
+		elapsed_time += 1.0 / 120.0;
+		computeSolarSystem(elapsed_time, planet_stack);
+		benchmark::DoNotOptimize(planet_stack.top().second);
+		while (!planet_stack.empty()) { planet_stack.pop(); }
+	}
+}
+BENCHMARK(BM_SolarSystemTransforms);
+
+//-------------------- Light Clustering
+static void BM_ClusterLights(benchmark::State& state)
+{
+	unsigned int light_count = (unsigned int)state.range(0);
+	std::minstd_rand generator(1);
+	std::uniform_real_distribution<float> position(-150.f, 150.f);
+
+	//Small engine glow sized lights scattered through the scene, the sun covers every cluster
+	LightClusters lights;
+	lights.AddLight({ glm::vec3(0.f), glm::vec3(.22f, .35f, .7f), glm::vec3(9.5f, 6.6f, 2.f), glm::vec3(.97f, .95f, .72f), 0.1f, 0.02f, 0.00025f });
+	for (unsigned int i = 1; i < light_count; i++)
+	{
+		glm::vec3 light_position(position(generator), position(generator) * 0.1f, position(generator));
+		lights.AddLight({ light_position, glm::vec3(0.f), glm::vec3(1.f, 0.6f, 0.2f), glm::vec3(0.2f), 1.f, 0.7f, 1.8f });
+	}
+
+	glm::mat4 projection = glm::perspective(glm::radians(80.f), 16.f / 9.f, 0.01f, 500.f);
+	glm::mat4 view = glm::lookAt(glm::vec3(0.f, 20.f, 120.f), glm::vec3(0.f), glm::vec3(0.f, 1.f, 0.f));
+
+	for (auto _ : state)
+	{
+		lights.Bin(view, projection);
+	}
+	state.SetItemsProcessed(state.iterations() * light_count);
+}
+BENCHMARK(BM_ClusterLights)->Arg(4)->Arg(64)->Arg(256)->Arg(1024)->Unit(benchmark::kMicrosecond);
+
+//-------------------- Texture Streaming
+static void BM_TextureDownsample(benchmark::State& state)
+{ //One mip level of an RGBA texture, the decode thread builds whole chains out of these
+	int size = (int)state.range(0);
+	std::minstd_rand generator(1);
+	std::vector<unsigned char> pixels((size_t)size * size * 4);
+	for (unsigned char& value : pixels) { value = (unsigned char)generator(); }
+
+	for (auto _ : state)
+	{
+		std::vector<unsigned char> level = downsampleMip(pixels, size, size, 4);
+		benchmark::DoNotOptimize(level.data());
+	}
+	state.SetBytesProcessed(state.iterations() * pixels.size());
+}
+BENCHMARK(BM_TextureDownsample)->Arg(512)->Arg(2048)->Arg(4096)->Unit(benchmark::kMicrosecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,189 @@
+#pragma once
+#ifndef ASTEROID_FIELD_H
+#define ASTEROID_FIELD_H
+
+#include "Core_Header.h"
+#include "Orbit_Instance.h"
+#include "Job_System.h"
+
+uint64_t counterHash(uint64_t seed, uint64_t counter)
+{ //SplitMix64 finalizer, each (seed, counter) pair gives an independent value without any shared generator state
+	uint64_t z = seed + (counter + 1) * 0x9E3779B97F4A7C15ull;
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+	return z ^ (z >> 31);
+}
+
+float counterRandom(uint64_t seed, uint64_t index, unsigned int stream)
+{ //Uniform float in [0, 1), stream picks one of the random values belonging to an instance
+	const unsigned int STREAMS_PER_INSTANCE = 8;
+	return (float)(counterHash(seed, index * STREAMS_PER_INSTANCE + stream) >> 40) * (1.f / 16777216.f);
+}
+
+Orbit_Instance generateAsteroidOrbit(uint64_t seed, uint64_t index, float offset, float radius)
+{
+	Orbit_Instance orbit;
+
+	//Random Position
+	float angle = counterRandom(seed, index, 0) * glm::two_pi<float>();
+	float x = cos(angle) * radius + (counterRandom(seed, index, 1) * 2.f - 1.f) * offset;
+	float z = sin(angle) * radius + (counterRandom(seed, index, 2) * 2.f - 1.f) * offset;
+
+	orbit.radius = sqrt(x * x + z * z);
+	orbit.phase = atan2(z, x);
+	orbit.height = (counterRandom(seed, index, 3) * 2.f - 1.f) * offset * 0.1f;
+
+	//Inner asteroids orbit faster, roughly following Kepler's third law
+	orbit.angular_speed = 0.02f * pow(100.f / orbit.radius, 1.5f);
+	orbit.tilt = glm::radians(counterRandom(seed, index, 4) * 4.f - 2.f);
+
+	//Random Scale
+	orbit.scale = floor(counterRandom(seed, index, 5) * 6.f) / 10.f + 0.5f;
+
+	//Random Rotation
+	orbit.spin_phase = counterRandom(seed, index, 6) * glm::two_pi<float>();
+	orbit.spin_speed = counterRandom(seed, index, 7) - 0.5f;
+
+	return orbit;
+}
+
+std::vector<Orbit_Instance> generateAsteroidOrbits(unsigned int amount, float offset, float radius, uint64_t seed, JobSystem* jobs = NULL)
+{ //Every instance only depends on the seed and its index, so the belt is identical however the work is split.
+	const unsigned int BATCH_SIZE = 16384;
+
+	std::vector<Orbit_Instance> asteroidOrbits(amount);
+	auto generateBatch = [&asteroidOrbits, offset, radius, seed](unsigned int begin, unsigned int end)
+	{
+		for (unsigned int i = begin; i < end; i++)
+		{
+			asteroidOrbits[i] = generateAsteroidOrbit(seed, i, offset, radius);
+		}
+	};
+
+	if (jobs) { jobs->ParallelFor(amount, BATCH_SIZE, generateBatch); }
+	else { generateBatch(0, amount); }
+
+	return asteroidOrbits;
+}
+
+//Instances that started in one radius band and one sector of the orbit. Orbits drift apart at different speeds, so the
+//bounds are kept as orbital elements and turned into a sphere for the current time when culling.
+struct Asteroid_Chunk
+{
+	unsigned int first, count; //Range of the belt's instances
+	float min_radius, max_radius;
+	float min_phase, max_phase; //At time 0
+	float min_speed, max_speed;
+	float max_height; //Distance from the orbit plane, including what the tilt adds
+	float max_scale;
+};
+
+//Sorts the instances by chunk so every chunk is one contiguous range of the instance buffer. Chunks aim for a few
+//thousand instances each, the default belts end up with one sector per band and draw in a single range when in view.
+std::vector<Asteroid_Chunk> chunkAsteroidOrbits(std::vector<Orbit_Instance>& orbits)
+{
+	const unsigned int RADIUS_BANDS = 4;
+	const unsigned int CHUNK_SIZE = 4096; //Smaller chunks cull tighter but cost more draws
+	const unsigned int MAX_SECTORS = 64;
+	std::vector<Asteroid_Chunk> chunks;
+	if (orbits.empty()) { return chunks; }
+
+	unsigned int sectors = std::min(std::max((unsigned int)orbits.size() / (RADIUS_BANDS * CHUNK_SIZE), 1u), MAX_SECTORS);
+	float min_radius = FLT_MAX, max_radius = 0.f;
+	for (const Orbit_Instance& orbit : orbits)
+	{
+		min_radius = std::min(min_radius, orbit.radius);
+		max_radius = std::max(max_radius, orbit.radius);
+	}
+	float band_width = std::max(max_radius - min_radius, 0.0001f) / RADIUS_BANDS;
+
+	auto chunkIndex = [&](const Orbit_Instance& orbit)
+	{
+		unsigned int band = std::min((unsigned int)((orbit.radius - min_radius) / band_width), RADIUS_BANDS - 1);
+		float turn = (orbit.phase + glm::pi<float>()) / glm::two_pi<float>(); //Phases come from atan2, in [-pi, pi]
+		unsigned int sector = std::min((unsigned int)(turn * sectors), sectors - 1);
+		return band * sectors + sector;
+	};
+
+	//Counting sort, stable so the belt stays the same for a seed
+	std::vector<unsigned int> starts(RADIUS_BANDS * sectors + 1, 0);
+	for (const Orbit_Instance& orbit : orbits) { starts[chunkIndex(orbit) + 1]++; }
+	for (unsigned int i = 1; i < starts.size(); i++) { starts[i] += starts[i - 1]; }
+
+	std::vector<unsigned int> next(starts.begin(), starts.end() - 1);
+	std::vector<Orbit_Instance> sorted(orbits.size());
+	for (const Orbit_Instance& orbit : orbits) { sorted[next[chunkIndex(orbit)]++] = orbit; }
+	orbits.swap(sorted);
+
+	for (unsigned int c = 0; c + 1 < starts.size(); c++)
+	{
+		if (starts[c] == starts[c + 1]) { continue; }
+		Asteroid_Chunk chunk = { starts[c], starts[c + 1] - starts[c], FLT_MAX, 0.f, FLT_MAX, -FLT_MAX, FLT_MAX, 0.f, 0.f, 0.f };
+		for (unsigned int i = chunk.first; i < chunk.first + chunk.count; i++)
+		{
+			const Orbit_Instance& orbit = orbits[i];
+			chunk.min_radius = std::min(chunk.min_radius, orbit.radius);
+			chunk.max_radius = std::max(chunk.max_radius, orbit.radius);
+			chunk.min_phase = std::min(chunk.min_phase, orbit.phase);
+			chunk.max_phase = std::max(chunk.max_phase, orbit.phase);
+			chunk.min_speed = std::min(chunk.min_speed, orbit.angular_speed);
+			chunk.max_speed = std::max(chunk.max_speed, orbit.angular_speed);
+			chunk.max_height = std::max(chunk.max_height, std::abs(orbit.height) + std::abs(std::sin(orbit.tilt)) * orbit.radius);
+			chunk.max_scale = std::max(chunk.max_scale, orbit.scale);
+		}
+		chunks.push_back(chunk);
+	}
+	return chunks;
+}
+
+//Sphere around everything a chunk can cover at time. Orbits only move forward, so the chunk spans from its earliest
+//phase moving at the slowest speed to its latest phase moving at the fastest.
+void asteroidChunkBounds(const Asteroid_Chunk& chunk, float time, float asteroid_radius, glm::vec3& center, float& radius)
+{
+	float begin = chunk.min_phase + chunk.min_speed * time;
+	float end = chunk.max_phase + chunk.max_speed * time;
+	float slack = 2.f * chunk.max_height + chunk.max_scale * asteroid_radius; //The tilt moves points up to max_height in y and z
+
+	if (end - begin >= glm::pi<float>())
+	{ //Spread over half the orbit or more, the whole ring bounds it better
+		center = glm::vec3(0.f);
+		radius = chunk.max_radius + slack;
+		return;
+	}
+
+	float middle = (begin + end) * 0.5f;
+	float mid_radius = (chunk.min_radius + chunk.max_radius) * 0.5f;
+	center = glm::vec3(cos(middle) * mid_radius, 0.f, sin(middle) * mid_radius);
+
+	//Within half an orbit the farthest point of the annular sector from its middle is one of its corners
+	float angles[2] = { begin, end };
+	float radii[2] = { chunk.min_radius, chunk.max_radius };
+	radius = 0.f;
+	for (float angle : angles)
+	{
+		for (float corner_radius : radii)
+		{
+			radius = std::max(radius, glm::length(glm::vec3(cos(angle) * corner_radius, 0.f, sin(angle) * corner_radius) - center));
+		}
+	}
+	radius += slack;
+}
+
+//The instance ranges to draw, chunks are in instance order so neighbouring visible chunks merge into one range
+void cullAsteroidChunks(const std::vector<Asteroid_Chunk>& chunks, float time, float asteroid_radius,
+	const std::function<bool(const glm::vec3&, float)>& visible, std::vector<Instance_Range>& ranges)
+{
+	ranges.clear();
+	for (const Asteroid_Chunk& chunk : chunks)
+	{
+		glm::vec3 center;
+		float radius;
+		asteroidChunkBounds(chunk, time, asteroid_radius, center, radius);
+		if (!visible(center, radius)) { continue; }
+
+		if (!ranges.empty() && ranges.back().first + ranges.back().count == chunk.first) { ranges.back().count += chunk.count; }
+		else { ranges.push_back({ chunk.first, chunk.count }); }
+	}
+}
+
+#endif
@@ -18,6 +18,14 @@ private:
 	glm::vec3 orientation = glm::vec3(0.0, 0.0, 1.0);
 	glm::vec3 up_dir = glm::vec3(0.0, 1.0, 0.0);
 
+	//Interpolation between simulation steps
+	glm::vec3 prev_camera_pos = camera_pos;
+	glm::vec3 prev_orientation = orientation;
+	glm::vec3 stepped_camera_pos = camera_pos;
+	glm::vec3 stepped_orientation = orientation;
+	glm::vec3 render_camera_pos = camera_pos;
+	glm::mat4 render_view;
+
 	const float CAMERA_SPEED = .2f; //0.2 default
 	float extra_camera_speed;
 	const float FRICTION = 2.5f;
@@ -36,6 +44,7 @@ public:
 		screen_height = h;
 
 		view = glm::lookAt(camera_pos, camera_pos + orientation, up_dir);
+		render_view = view;
 		projection = glm::perspective(glm::radians(80.f), float(w) / float(h), near_plane_dist, far_plane_dist);
 		return true;
 	}
@@ -55,6 +64,10 @@ public:
 
 	void Update(float dt)
 	{
+		//Mouse look happens between steps, so the previous state is taken from the end of the last step
+		prev_camera_pos = stepped_camera_pos;
+		prev_orientation = stepped_orientation;
+
 		if (glm::length(velocity) < 0.0001) { velocity = glm::vec3(0.0f); }
 		else 
 		{ 
@@ -66,6 +79,25 @@ public:
 		camera_pos += velocity * (CAMERA_SPEED + extra_camera_speed) * dt; //Delta time keeps the camera's speed consistent across machines.
 	}
 
+	void EndStep()
+	{
+		stepped_camera_pos = camera_pos;
+		stepped_orientation = orientation;
+	}
+
+	void Interpolate(float alpha)
+	{
+		render_camera_pos = glm::mix(prev_camera_pos, camera_pos, alpha);
+		glm::vec3 render_orientation = glm::normalize(glm::mix(prev_orientation, orientation, alpha));
+		render_view = glm::lookAt(render_camera_pos, render_camera_pos + render_orientation, up_dir);
+	}
+
+	void ResetInterpolation()
+	{ //Used after teleporting so the camera does not sweep across the scene.
+		prev_camera_pos = stepped_camera_pos = camera_pos;
+		prev_orientation = stepped_orientation = orientation;
+	}
+
 	void setExtraSpeed(float speed)
 	{
 		extra_camera_speed = speed;
@@ -130,6 +162,16 @@ public:
 		return view;
 	}
 
+	glm::mat4 GetRenderView()
+	{
+		return render_view;
+	}
+
+	glm::vec3 getRenderPosition()
+	{
+		return render_camera_pos;
+	}
+
 	void setFOV(float fov_amount)
 	{
 		projection = glm::perspective(glm::radians(fov_amount), (float)screen_width / (float)screen_height, near_plane_dist, far_plane_dist);
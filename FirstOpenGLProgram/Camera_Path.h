@@ -0,0 +1,115 @@
+#pragma once
+#ifndef CAMERA_PATH_H
+#define CAMERA_PATH_H
+
+#include "Main_Header.h"
+
+class CameraPath
+{
+public:
+	struct Keyframe
+	{
+		float time;
+		glm::vec3 position;
+		glm::vec3 target; //Point the camera looks at
+	};
+
+	struct Visit
+	{
+		float time;
+		std::string planet;
+		float duration;
+	};
+
+private:
+	std::vector<Keyframe> keyframes;
+	std::vector<Visit> visits;
+
+	static glm::vec3 catmullRom(const glm::vec3& p0, const glm::vec3& p1, const glm::vec3& p2, const glm::vec3& p3, float t)
+	{
+		float t2 = t * t;
+		float t3 = t2 * t;
+		return 0.5f * ((2.f * p1) + (-p0 + p2) * t + (2.f * p0 - 5.f * p1 + 4.f * p2 - p3) * t2 + (-p0 + 3.f * p1 - 3.f * p2 + p3) * t3);
+	}
+
+public:
+	//Path files hold one entry per line, sorted by time:
+	//  key <time> <x> <y> <z> <target x> <target y> <target z>
+	//  visit <time> <planet> <duration>
+	bool Initialize(const std::string& file_path)
+	{
+		std::ifstream path_file(file_path);
+		if (!path_file.is_open())
+		{
+			std::cerr << "Error: Could not Open File!\n" << file_path << std::endl;
+			return false;
+		}
+
+		std::string line;
+		while (std::getline(path_file, line))
+		{
+			std::stringstream entry(line);
+			std::string type;
+			if (!(entry >> type) || type[0] == '#') { continue; }
+
+			if (type == "key")
+			{
+				Keyframe keyframe;
+				entry >> keyframe.time >> keyframe.position.x >> keyframe.position.y >> keyframe.position.z
+					>> keyframe.target.x >> keyframe.target.y >> keyframe.target.z;
+				if (entry.fail()) { std::cerr << "Error: Bad camera path keyframe: " << line << std::endl; return false; }
+				keyframes.push_back(keyframe);
+			}
+			else if (type == "visit")
+			{
+				Visit visit;
+				entry >> visit.time >> visit.planet >> visit.duration;
+				if (entry.fail()) { std::cerr << "Error: Bad camera path visit: " << line << std::endl; return false; }
+				visits.push_back(visit);
+			}
+		}
+		path_file.close();
+
+		if (keyframes.size() < 2)
+		{
+			std::cerr << "Error: Camera path needs at least two keyframes!\n" << file_path << std::endl;
+			return false;
+		}
+		return true;
+	}
+
+	void Evaluate(float time, glm::vec3& position, glm::vec3& target)
+	{ //Catmull-Rom spline through the keyframes, so the camera passes through every recorded point.
+		time = glm::clamp(time, keyframes.front().time, keyframes.back().time);
+
+		unsigned int i = 0;
+		while (i + 2 < keyframes.size() && keyframes[i + 1].time <= time) { i++; }
+
+		const Keyframe& k0 = keyframes[i > 0 ? i - 1 : i];
+		const Keyframe& k1 = keyframes[i];
+		const Keyframe& k2 = keyframes[i + 1];
+		const Keyframe& k3 = keyframes[std::min(i + 2, (unsigned int)keyframes.size() - 1)];
+
+		float t = (time - k1.time) / std::max(k2.time - k1.time, 0.0001f);
+		t = glm::clamp(t, 0.f, 1.f);
+		position = catmullRom(k0.position, k1.position, k2.position, k3.position, t);
+		target = catmullRom(k0.target, k1.target, k2.target, k3.target, t);
+	}
+
+	const std::vector<Visit>& getVisits()
+	{
+		return visits;
+	}
+
+	float getDuration()
+	{
+		float duration = keyframes.empty() ? 0.f : keyframes.back().time;
+		for (const Visit& visit : visits)
+		{
+			duration = std::max(duration, visit.time + visit.duration);
+		}
+		return duration;
+	}
+};
+
+#endif
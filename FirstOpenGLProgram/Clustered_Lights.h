@@ -0,0 +1,59 @@
+#pragma once
+#ifndef CLUSTERED_LIGHTS_H
+#define CLUSTERED_LIGHTS_H
+
+#include "Main_Header.h"
+#include "Shader.h"
+#include "Render_Stats.h"
+#include "Debug_Output.h"
+#include "Memory_Tracker.h"
+#include "Light_Clusters.h"
+
+class ClusteredLights : public LightClusters
+{
+private:
+	unsigned int light_buffer = 0, cluster_buffer = 0, index_buffer = 0;
+
+	void uploadBuffer(unsigned int buffer, const void* data, size_t bytes, const std::string& owner)
+	{
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, buffer);
+		glBufferData(GL_SHADER_STORAGE_BUFFER, bytes, data, GL_STREAM_DRAW);
+		render_stats.CountBufferUpload(bytes);
+		memory_tracker.Allocate(GL_BUFFER, buffer, MemoryTracker::STORAGE_BUFFER, owner, bytes);
+	}
+
+public:
+	bool Initialize()
+	{
+		glGenBuffers(1, &light_buffer);
+		glGenBuffers(1, &cluster_buffer);
+		glGenBuffers(1, &index_buffer);
+		debug_output.Label(GL_BUFFER, light_buffer, "Point Lights");
+		debug_output.Label(GL_BUFFER, cluster_buffer, "Light Clusters");
+		debug_output.Label(GL_BUFFER, index_buffer, "Light Indices");
+		return true;
+	}
+
+	void Upload()
+	{
+		if (gpu_lights.empty()) { gpu_lights.resize(1); }
+		uploadBuffer(light_buffer, gpu_lights.data(), sizeof(Gpu_Point_Light) * gpu_lights.size(), "Point Lights");
+		uploadBuffer(cluster_buffer, clusters.data(), sizeof(Light_Cluster) * clusters.size(), "Light Clusters");
+		uploadBuffer(index_buffer, indices.data(), sizeof(unsigned int) * indices.size(), "Light Indices");
+		glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+	}
+
+	//Binds the light buffers and sets the cluster lookup for a viewport of the given size.
+	void Bind(Shader& shader, int viewport_width, int viewport_height)
+	{
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, light_buffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, cluster_buffer);
+		glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, index_buffer);
+
+		uploadUniform(glUniform3ui, shader.GetUniformLocation("cluster_grid"), GRID_X, GRID_Y, GRID_Z);
+		uploadUniform(glUniform2f, shader.GetUniformLocation("cluster_tile_scale"), (float)GRID_X / viewport_width, (float)GRID_Y / viewport_height);
+		uploadUniform(glUniform2f, shader.GetUniformLocation("cluster_slice"), slice_scale, slice_bias);
+	}
+};
+
+#endif
@@ -0,0 +1,41 @@
+#pragma once
+#ifndef CORE_HEADER_H
+#define CORE_HEADER_H
+
+//Math and standard library only. Headers that never touch GL, GLFW or assimp include this instead of Main_Header.h, so
+//the benchmarks can build them without those libraries.
+#include <glm/glm.hpp>
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/type_ptr.hpp>
+#include <glm/gtc/random.hpp>
+#include <glm/gtc/quaternion.hpp>
+
+#define GLM_ENABLE_EXPERIMENTAL
+#include <glm/gtx/rotate_vector.hpp>
+#include<glm/gtx/vector_angle.hpp>
+#include "glm/ext.hpp"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <stack>
+#include <map>
+#include <set>
+#include <cstring>
+#include <cctype>
+#include <cfloat>
+#include <cstdint>
+#include <chrono>
+#include <iomanip>
+#include <algorithm>
+#include <deque>
+#include <random>
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+
+#endif
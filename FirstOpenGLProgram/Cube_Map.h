@@ -38,10 +38,18 @@ public:
 		//Vertex VBO
 		glBindBuffer(GL_ARRAY_BUFFER, skyboxVB);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * Vertices.size(), &Vertices[0], GL_STATIC_DRAW);
+		render_stats.CountBufferUpload(sizeof(Vertex) * Vertices.size());
 
 		//Index VBO
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, skyboxIB);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * Indices.size(), &Indices[0], GL_STATIC_DRAW);
+		render_stats.CountBufferUpload(sizeof(unsigned int) * Indices.size());
+		memory_tracker.Allocate(GL_BUFFER, skyboxVB, MemoryTracker::VERTEX_BUFFER, object_file_path, sizeof(Vertex) * Vertices.size());
+		memory_tracker.Allocate(GL_BUFFER, skyboxIB, MemoryTracker::INDEX_BUFFER, object_file_path, sizeof(unsigned int) * Indices.size());
+
+		debug_output.Label(GL_VERTEX_ARRAY, VAO, "Skybox VAO");
+		debug_output.Label(GL_BUFFER, skyboxVB, "Skybox Vertices");
+		debug_output.Label(GL_BUFFER, skyboxIB, "Skybox Indices");
 
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), 0);
@@ -56,8 +64,10 @@ public:
 	void Render()
 	{
 		glBindVertexArray(VAO);
+		render_stats.CountVertexArray();
 		m_cube_map_texture->bindCubeMapTextures();
 		glDrawElements(GL_TRIANGLES, Indices.size(), GL_UNSIGNED_INT, 0);
+		render_stats.CountDraw(Indices.size() / 3);
 		glBindVertexArray(0);
 	}
 
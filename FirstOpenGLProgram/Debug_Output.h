@@ -0,0 +1,177 @@
+#pragma once
+#ifndef DEBUG_OUTPUT_H
+#define DEBUG_OUTPUT_H
+
+#include "Main_Header.h"
+
+class DebugOutput
+{
+private:
+	//The driver may call back from its own threads, so messages go into a fixed ring and are printed once per frame
+	static const unsigned int CAPACITY = 256; //Power of two
+	static const unsigned int MESSAGE_LENGTH = 256;
+
+	struct Message
+	{
+		GLenum source, type, severity;
+		GLuint id;
+		char text[MESSAGE_LENGTH];
+	};
+
+	struct Slot
+	{
+		std::atomic<size_t> sequence;
+		Message message;
+	};
+
+	Slot slots[CAPACITY];
+	std::atomic<size_t> write_position{ 0 };
+	size_t read_position = 0; //Only the main thread reads
+	std::atomic<unsigned int> dropped{ 0 };
+	bool enabled = false;
+
+	static void GLAPIENTRY messageCallback(GLenum source, GLenum type, GLuint id, GLenum severity, GLsizei length, const GLchar* message, const void* user_param)
+	{
+		((DebugOutput*)user_param)->Push(source, type, id, severity, message);
+	}
+
+	static const char* sourceString(GLenum source)
+	{
+		switch (source)
+		{
+		case GL_DEBUG_SOURCE_API: return "API";
+		case GL_DEBUG_SOURCE_WINDOW_SYSTEM: return "Window System";
+		case GL_DEBUG_SOURCE_SHADER_COMPILER: return "Shader Compiler";
+		case GL_DEBUG_SOURCE_THIRD_PARTY: return "Third Party";
+		case GL_DEBUG_SOURCE_APPLICATION: return "Application";
+		default: return "Other";
+		}
+	}
+
+	static const char* typeString(GLenum type)
+	{
+		switch (type)
+		{
+		case GL_DEBUG_TYPE_ERROR: return "Error";
+		case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: return "Deprecated";
+		case GL_DEBUG_TYPE_UNDEFINED_BEHAVIOR: return "Undefined Behavior";
+		case GL_DEBUG_TYPE_PORTABILITY: return "Portability";
+		case GL_DEBUG_TYPE_PERFORMANCE: return "Performance";
+		case GL_DEBUG_TYPE_MARKER: return "Marker";
+		default: return "Other";
+		}
+	}
+
+	static const char* severityString(GLenum severity)
+	{
+		switch (severity)
+		{
+		case GL_DEBUG_SEVERITY_HIGH: return "High";
+		case GL_DEBUG_SEVERITY_MEDIUM: return "Medium";
+		case GL_DEBUG_SEVERITY_LOW: return "Low";
+		default: return "Notification";
+		}
+	}
+
+public:
+	DebugOutput()
+	{
+		for (unsigned int i = 0; i < CAPACITY; i++) { slots[i].sequence = i; }
+	}
+
+	//Only a debug context reports everything, without one the labels and groups are skipped too.
+	bool Initialize()
+	{
+		GLint context_flags = 0;
+		glGetIntegerv(GL_CONTEXT_FLAGS, &context_flags);
+		if (!GLEW_KHR_debug || !(context_flags & GL_CONTEXT_FLAG_DEBUG_BIT)) { return false; }
+
+		glEnable(GL_DEBUG_OUTPUT); //Not synchronous, the driver is free to report late and from any thread
+		glDebugMessageCallback(messageCallback, this);
+		glDebugMessageControl(GL_DONT_CARE, GL_DONT_CARE, GL_DEBUG_SEVERITY_NOTIFICATION, 0, NULL, GL_FALSE);
+		glDebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_PUSH_GROUP, GL_DONT_CARE, 0, NULL, GL_FALSE);
+		glDebugMessageControl(GL_DEBUG_SOURCE_APPLICATION, GL_DEBUG_TYPE_POP_GROUP, GL_DONT_CARE, 0, NULL, GL_FALSE);
+		enabled = true;
+
+		std::cout << "GL Debug Output: Enabled" << std::endl;
+		return true;
+	}
+
+	bool isEnabled()
+	{
+		return enabled;
+	}
+
+	//Lock-free, safe from any thread. Drops the message when the ring is full.
+	void Push(GLenum source, GLenum type, GLuint id, GLenum severity, const char* text)
+	{
+		size_t position = write_position.load(std::memory_order_relaxed);
+		Slot* slot;
+		while (true)
+		{
+			slot = &slots[position & (CAPACITY - 1)];
+			size_t sequence = slot->sequence.load(std::memory_order_acquire);
+			intptr_t difference = (intptr_t)sequence - (intptr_t)position;
+
+			if (difference == 0)
+			{
+				if (write_position.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) { break; }
+			}
+			else if (difference < 0)
+			{
+				dropped++;
+				return;
+			}
+			else
+			{
+				position = write_position.load(std::memory_order_relaxed);
+			}
+		}
+
+		slot->message.source = source;
+		slot->message.type = type;
+		slot->message.id = id;
+		slot->message.severity = severity;
+		snprintf(slot->message.text, MESSAGE_LENGTH, "%s", text);
+		slot->sequence.store(position + 1, std::memory_order_release);
+	}
+
+	//Prints everything collected since the last flush. Main thread only.
+	void Flush(std::ostream& out)
+	{
+		while (true)
+		{
+			Slot& slot = slots[read_position & (CAPACITY - 1)];
+			if (slot.sequence.load(std::memory_order_acquire) != read_position + 1) { break; }
+
+			const Message& message = slot.message;
+			out << "GL " << severityString(message.severity) << " " << typeString(message.type) << " ("
+				<< sourceString(message.source) << " " << message.id << "): " << message.text << std::endl;
+
+			slot.sequence.store(read_position + CAPACITY, std::memory_order_release);
+			read_position++;
+		}
+
+		unsigned int dropped_count = dropped.exchange(0);
+		if (dropped_count > 0) { out << "GL Debug Output: " << dropped_count << " messages dropped" << std::endl; }
+	}
+
+	void PushGroup(const std::string& name)
+	{
+		if (enabled) { glPushDebugGroup(GL_DEBUG_SOURCE_APPLICATION, 0, -1, name.c_str()); }
+	}
+
+	void PopGroup()
+	{
+		if (enabled) { glPopDebugGroup(); }
+	}
+
+	void Label(GLenum identifier, GLuint name, const std::string& label)
+	{ //Objects made by glGen* have to be bound once before they can be labeled
+		if (enabled && name != 0) { glObjectLabel(identifier, name, -1, label.c_str()); }
+	}
+};
+
+DebugOutput debug_output;
+
+#endif
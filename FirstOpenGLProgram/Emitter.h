@@ -3,50 +3,33 @@
 #define EMITTER_H
 
 #include "Shader.h"
+#include "Render_Stats.h"
+#include "Debug_Output.h"
+#include "Memory_Tracker.h"
 #include "Main_Header.h"
+#include "Particle_Simulation.h"
 
-class Emitter 
+class Emitter : public ParticleSimulation
 {
 private:
-	struct Particle
-	{
-		glm::vec3 position, velocity;
+	struct ParticleInstance
+	{ //Per instance attributes, one for every live particle
+		glm::vec3 offset;
 		glm::vec4 color;
-		float life;
-
-		Particle() : position(0.f), velocity(0.f), color(1.f), life(0.f) { }
 	};
-	std::vector<Particle> particles;
+	std::vector<ParticleInstance> instances;
 
-	//Particle settings
 	const char* texture_path;
-	unsigned int particle_total;
-	unsigned int spawn_amount;
-	float particle_range;
-	float particle_life;
-
 	unsigned int particleVBO, particleVAO;
-	unsigned int last_used_particle = 0;
+	unsigned int instanceVBO;
 	unsigned int particle_texture;
-	unsigned int spawn_rate;
-	float spawn_accumulator;
-	glm::vec3 particle_velocity;
-	glm::vec3 prev_origin;
-
-	bool local_space = true;
 
 public:
-	void useWorldSpace() { local_space = false; }
-	void useLocalSpace() { local_space = true; }
-
 	void Initialize(const char* texture_path, unsigned int total_spawned, unsigned int spawn_amount, unsigned int rate, float range, float life)
 	{
 		this->texture_path = texture_path;
-		particle_total = total_spawned;
-		this->spawn_amount = spawn_amount;
-		spawn_rate = rate;
-		particle_range = range;
-		particle_life = life;
+		Configure(total_spawned, spawn_amount, rate, range, life, rand());
+		instances.reserve(particle_total);
 
 		float quadVertices[] = {
 			-1.0f,  1.0f, 0.0f, 0.0f, 1.0f,
@@ -59,7 +42,11 @@ public:
 		glGenBuffers(1, &particleVBO);
 		glBindVertexArray(particleVAO);
 		glBindBuffer(GL_ARRAY_BUFFER, particleVBO);
+		debug_output.Label(GL_VERTEX_ARRAY, particleVAO, "Particle Quad VAO");
+		debug_output.Label(GL_BUFFER, particleVBO, "Particle Quad Vertices");
 		glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+		render_stats.CountBufferUpload(sizeof(quadVertices));
+		memory_tracker.Allocate(GL_BUFFER, particleVBO, MemoryTracker::VERTEX_BUFFER, "Particle Quad", sizeof(quadVertices));
 
 		glEnableVertexAttribArray(0);
 		glEnableVertexAttribArray(1);
@@ -67,106 +54,62 @@ public:
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)0);
 		glVertexAttribPointer(1, 2, GL_FLOAT, GL_FALSE, 5 * sizeof(float), (void*)(3 * sizeof(float)));
 
-		glBindVertexArray(0);
-
-		particle_texture = TextureFromFile(texture_path);
-
-		for (unsigned int i = 0; i < particle_total; i++)
-		{
-			particles.push_back(Particle());
-		}
-	}
+		//Live particles are packed in here every frame, so all of them draw in one instanced call
+		glGenBuffers(1, &instanceVBO);
+		glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+		debug_output.Label(GL_BUFFER, instanceVBO, "Particle Instances");
+		glBufferData(GL_ARRAY_BUFFER, particle_total * sizeof(ParticleInstance), NULL, GL_STREAM_DRAW);
+		memory_tracker.Allocate(GL_BUFFER, instanceVBO, MemoryTracker::INSTANCE_BUFFER, texture_path, particle_total * sizeof(ParticleInstance));
 
-	unsigned int firstUnusedParticle()
-	{
-		for (unsigned int i = last_used_particle; i < particle_total; i++) //First attempt to find, usually works
-		{
-			if (particles[i].life <= 0.f)
-			{
-				last_used_particle = i;
-				return i;
-			}
-		}
+		glEnableVertexAttribArray(2);
+		glEnableVertexAttribArray(3);
+		glVertexAttribPointer(2, 3, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)offsetof(ParticleInstance, offset));
+		glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(ParticleInstance), (void*)offsetof(ParticleInstance, color));
+		glVertexAttribDivisor(2, 1);
+		glVertexAttribDivisor(3, 1);
 
-		//Linear Search
-		for (unsigned int i = 0; i < particle_total; i++)
-		{
-			if (particles[i].life <= 0.f)
-			{
-				last_used_particle = i;
-				return i;
-			}
-		}
+		glBindVertexArray(0);
 
-		last_used_particle = 0;
-		return 0;
+		particle_texture = TextureFromFile(texture_path);
 	}
 
-	void respawnParticle(Particle &particle, glm::vec3 particle_origin, glm::vec3 particle_velocity)
-	{
-		glm::vec3 offset = glm::sphericalRand(particle_range);
-		particle.position = particle_origin + offset;
-		particle.life = particle_life;
-		particle.velocity = particle_velocity;
-		particle.color = glm::vec4(1.0f);
-	}
 
-	void emitParticles(double dt, glm::vec3 origin, glm::vec3 velocity)
+	//The pass drawing the emitter owns the blend and depth state. SORTED emitters go out in the order of the last
+	//SortParticles, the others draw into the transparency targets in storage order, since order does not matter there.
+	void Render(Shader& shader)
 	{
-		glm::vec3 object_movement = origin - prev_origin;
-		prev_origin = origin;
-
-		spawn_accumulator += spawn_rate * dt;
-
-		if (spawn_accumulator > 1)
+		instances.clear();
+		if (blending == SORTED)
 		{
-			spawn_accumulator = 0;
-			for (unsigned int i = 0; i < spawn_amount; i++) //Emit new particles
+			for (unsigned int slot : draw_order)
 			{
-				int unused_particle = firstUnusedParticle();
-				respawnParticle(particles[unused_particle], origin, velocity);
+				if (particles[slot].life > 0.f) { instances.push_back({ particles[slot].position, particles[slot].color }); }
 			}
 		}
-
-		for (unsigned int i = 0; i < particle_total; i++) //Update particles
+		else
 		{
-			Particle& part = particles[i];
-			part.life -= dt;
-
-			if (part.life > 0.f)
+			for (const Particle& particle : particles)
 			{
-				//part.position -= part.velocity * dt;
-				if (local_space) { part.position += object_movement; }
-				part.position += part.velocity * dt;
-				part.color.a = part.life / particle_life;
+				if (particle.life > 0.f) { instances.push_back({ particle.position, particle.color }); }
 			}
 		}
-	}
+		if (instances.empty()) { return; }
 
-	void Render(Shader& shader)
-	{
-		glDepthMask(GL_FALSE);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE);
+		glBindBuffer(GL_ARRAY_BUFFER, instanceVBO);
+		glBufferData(GL_ARRAY_BUFFER, particle_total * sizeof(ParticleInstance), NULL, GL_STREAM_DRAW); //Orphaned, the last frame's draw may still read it
+		glBufferSubData(GL_ARRAY_BUFFER, 0, instances.size() * sizeof(ParticleInstance), instances.data());
+		render_stats.CountBufferUpload(instances.size() * sizeof(ParticleInstance));
 
+		if (blending != SORTED) { uploadUniform(glUniform1f, shader.GetUniformLocation("additive"), blending == ADDITIVE ? 1.f : 0.f); }
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, particle_texture);
+		render_stats.CountTexture();
 
 		glBindVertexArray(particleVAO);
-		
-		for (unsigned int i = 0; i < particles.size(); i++)
-		{
-			if (particles[i].life > 0.f)
-			{
-				glUniform3fv(shader.GetUniformLocation("offset"), 1, glm::value_ptr(particles[i].position));
-				glUniform4fv(shader.GetUniformLocation("color"), 1, glm::value_ptr(particles[i].color));
-
-				glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
-			}
-		}
+		render_stats.CountVertexArray();
+		glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, instances.size());
+		render_stats.CountDraw(2, instances.size());
 		glBindVertexArray(0);
-
-		glDepthMask(GL_TRUE);
-		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 	}
 
 	unsigned int TextureFromFile(const char* texture_path)
@@ -184,8 +127,10 @@ public:
 			else if (nrComponents == 4) { format = GL_RGBA; }
 
 			glBindTexture(GL_TEXTURE_2D, texture_id);
+			debug_output.Label(GL_TEXTURE, texture_id, texture_path);
 			glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
 			glGenerateMipmap(GL_TEXTURE_2D);
+			memory_tracker.Allocate(GL_TEXTURE, texture_id, MemoryTracker::TEXTURE, texture_path, MemoryTracker::TextureBytes(width, height, nrComponents == 3 ? 4 : nrComponents, true));
 
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
 			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
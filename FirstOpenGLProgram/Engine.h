@@ -5,6 +5,7 @@
 #include "Main_Header.h"
 #include "Window.h"
 #include "Graphics.h"
+#include "Camera_Path.h"
 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset);
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods);
@@ -16,6 +17,10 @@ float zoom_amount;
 const float ZOOM_SPEED = 20;
 const float EXTRA_CAMERA_SPEED = .2f;
 bool accelerate_mode = false;
+const double SIM_TIME_STEP = 1.0 / 120.0; //Simulation always advances in fixed steps, independent of the frame rate
+const double MAX_FRAME_TIME = 0.25; //Caps the steps taken after a long stall
+const unsigned int BENCHMARK_SEED = 1234;
+const char* BENCHMARK_PATH = "paths/benchmark_path.txt";
 
 class Engine 
 {
@@ -29,10 +34,49 @@ private:
 
 	bool m_running;
 	bool m_FULLSCREEN;
+	bool m_HEADLESS = false;
+
+	//Frame limit and captures, mostly for headless runs
+	int m_frame_limit = 0; //0 runs until the window closes
+	int m_frame_count = 0;
+	int m_capture_frame = -1;
+	std::string m_capture_path = "frame.ppm";
+	bool capture_requested = false;
+	bool capture_pressed = false;
+	bool stats_pressed = false;
+	bool resolution_pressed = false;
+	bool shading_pressed = false;
+	bool prepass_pressed = false;
+	bool shadows_pressed = false;
+	bool shadow_filter_pressed = false;
+
+	//Dynamic resolution holds the GPU frame time near the budget, benchmarks and headless captures keep a fixed resolution
+	bool m_DYNAMIC_RESOLUTION = true;
+	bool m_SUPERSAMPLING = false;
+	float m_gpu_budget_ms = 14.f;
+	bool m_DEFERRED = false;
+	bool m_DEPTH_PREPASS = false;
+	bool m_VERTEX_PROBE = false;
+	unsigned int m_ASTEROID_COUNT = 1500;
+	bool m_SHADOWS = true;
+	bool m_SHADER_CACHE = true;
+	bool m_HOT_RELOAD = true; //Edited files in shaders/ are recompiled while running, never during benchmarks
+	bool m_TEXTURE_STREAMING = true;
+	int m_shadow_filter = ShadowMap::PCF_MEDIUM;
+
+	//Benchmark mode flies a recorded camera path with a fixed seed and clock, then writes a report
+	bool m_BENCHMARK = false;
+	std::string m_benchmark_report = "benchmark.json";
+	CameraPath* m_benchmark_path = NULL;
+	unsigned int benchmark_visit = 0;
+	double startup_time = 0.0;
+	std::vector<double> frame_times; //Milliseconds
+	std::vector<unsigned int> frame_draw_calls;
 
 	float delta_time = 0.0f;
 	float delta_time_2 = 0.f;
-	float last_frame = 0.0f;
+	double last_frame = 0.0;
+	double sim_accumulator = 0.0;
 
 	double last_mouse_x, last_mouse_y;
 	bool first_click = true;
@@ -53,14 +97,111 @@ public:
 	{
 		delete m_window;
 		delete m_graphics;
+		delete m_benchmark_path;
 		m_window = NULL;
 		m_graphics = NULL;
+		m_benchmark_path = NULL;
+	}
+
+	void setHeadless(bool headless)
+	{ //Renders offscreen at the engine's width and height, must be set before Initialize
+		m_HEADLESS = headless;
+	}
+
+	void setResolution(int width, int height)
+	{ //Internal resolution of headless runs, windows are fullscreen at the monitor's resolution
+		m_WINDOW_WIDTH = width;
+		m_WINDOW_HEIGHT = height;
+	}
+
+	void setFrameLimit(int frames)
+	{
+		m_frame_limit = frames;
+	}
+
+	void setCaptureFrame(int frame, std::string file_path)
+	{
+		m_capture_frame = frame;
+		m_capture_path = file_path;
+	}
+
+	void setDynamicResolution(bool enabled)
+	{
+		m_DYNAMIC_RESOLUTION = enabled;
+	}
+
+	void setSupersampling(bool enabled)
+	{
+		m_SUPERSAMPLING = enabled;
+	}
+
+	void setDeferred(bool deferred)
+	{
+		m_DEFERRED = deferred;
+	}
+
+	void setDepthPrepass(bool prepass)
+	{
+		m_DEPTH_PREPASS = prepass;
+	}
+
+	void setShadows(bool shadows)
+	{
+		m_SHADOWS = shadows;
+	}
+
+	void setShadowFilter(int filter)
+	{ //0 hard, 1 medium, 2 soft
+		m_shadow_filter = glm::clamp(filter, 0, ShadowMap::FILTER_COUNT - 1);
+	}
+
+	void setAsteroidCount(unsigned int asteroid_count)
+	{ //At least one instance per belt, the benchmark report records the clamped count
+		m_ASTEROID_COUNT = std::max(asteroid_count, 3u);
+	}
+
+	void setVertexProbe(bool vertex_probe)
+	{
+		m_VERTEX_PROBE = vertex_probe;
+	}
+
+	void setShaderCache(bool shader_cache)
+	{
+		m_SHADER_CACHE = shader_cache;
+	}
+
+	void setHotReload(bool hot_reload)
+	{
+		m_HOT_RELOAD = hot_reload;
+	}
+
+	void setTextureStreaming(bool texture_streaming)
+	{
+		m_TEXTURE_STREAMING = texture_streaming;
+	}
+
+	void setGpuBudget(float budget_ms)
+	{
+		m_gpu_budget_ms = budget_ms;
+	}
+
+	void setBenchmark(std::string report_path)
+	{ //Must be set before Initialize
+		m_BENCHMARK = true;
+		m_benchmark_report = report_path;
+	}
+
+	void CaptureFrame()
+	{ //Saves the next finished frame to the capture path
+		capture_requested = true;
 	}
 
 	bool Initialize()
 	{
+		auto startup_begin = std::chrono::steady_clock::now(); //GLFW's timer is not running before the window exists
+
 		//Start Window
-		m_window = new Window(m_WINDOW_NAME, &m_WINDOW_WIDTH, &m_WINDOW_HEIGHT);
+		m_window = new Window(m_WINDOW_NAME, &m_WINDOW_WIDTH, &m_WINDOW_HEIGHT, m_HEADLESS);
 		if (!m_window->Initialize())
 		{
 			std::cerr << "The window failed to Initalize!" << std::endl;
@@ -69,15 +210,42 @@ public:
 
 		//Start Graphics
 		m_graphics = new Graphics();
+		if (m_BENCHMARK) { m_graphics->setSeed(BENCHMARK_SEED); }
+		m_graphics->setShaderCache(m_SHADER_CACHE);
+		m_graphics->setAsteroidCount(m_ASTEROID_COUNT);
+		m_graphics->setVertexProbe(m_VERTEX_PROBE);
+		m_graphics->setShadows(m_SHADOWS, (ShadowMap::Filter)m_shadow_filter);
+		m_graphics->setTextureStreaming(m_TEXTURE_STREAMING && !m_BENCHMARK && !m_HEADLESS); //Reports and captures must not depend on the decode thread
 		if (!m_graphics->Initialize(m_window->getWindowWidth(), m_window->getWindowHeight()))
 		{
 			std::cerr << "The graphics failed to Initalize!" << std::endl;
 			return false;
 		}
+		m_graphics->setOutputFramebuffer(m_window->getFramebuffer());
+		m_graphics->setDynamicResolution(m_DYNAMIC_RESOLUTION && !m_BENCHMARK && !m_HEADLESS, m_gpu_budget_ms);
+		m_graphics->setSupersampling(m_SUPERSAMPLING);
+		m_graphics->setDeferredShading(m_DEFERRED);
+		m_graphics->setDepthPrepass(m_DEPTH_PREPASS);
+		m_graphics->setShaderHotReload(m_HOT_RELOAD && !m_BENCHMARK);
+		profiler.Initialize();
+		memory_tracker.PrintReport(std::cout);
 
 		glfwSetScrollCallback(m_window->getWindow(), scroll_callback);
 		glfwSetKeyCallback(m_window->getWindow(), key_callback);
-		
+
+		if (m_BENCHMARK)
+		{
+			m_benchmark_path = new CameraPath();
+			if (!m_benchmark_path->Initialize(BENCHMARK_PATH))
+			{
+				std::cerr << "The benchmark camera path failed to Initalize!" << std::endl;
+				return false;
+			}
+			if (m_frame_limit == 0) { m_frame_limit = (int)ceil(m_benchmark_path->getDuration() / SIM_TIME_STEP); }
+			if (!m_HEADLESS) { glfwSwapInterval(0); } //Measure the frame, not the display's refresh rate
+		}
+
+		startup_time = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - startup_begin).count();
 		return true;
 	}
 
@@ -85,24 +253,181 @@ public:
 	{
 		m_running = true;
 
+		last_frame = glfwGetTime();
+
 		while (!glfwWindowShouldClose(m_window->getWindow()))
 		{
-			float current_frame = glfwGetTime();
-			delta_time = current_frame - last_frame;
+			profiler.BeginFrame();
+			profiler.BeginMarker("Frame", false);
+
+			double current_frame = glfwGetTime();
+			if (m_BENCHMARK && m_frame_count > 0) { frame_times.push_back((current_frame - last_frame) * 1000.0); }
+			sim_accumulator += std::min(current_frame - last_frame, MAX_FRAME_TIME);
 			last_frame = current_frame;
 
-			ProcessInput();
-			Display(m_window->getWindow(), delta_time);
+			//Input is sampled once per step, mouse movement left over between steps is picked up by the next one
+			delta_time = (float)SIM_TIME_STEP;
+			{ //One "Update" sample per frame covering every catch-up step, so its stats are per frame like the other markers
+				ProfileScope update_scope("Update", false);
+				if (m_BENCHMARK)
+				{ //Exactly one step per frame, so every run simulates and renders the same frames
+					UpdateBenchmark();
+					m_graphics->Update(SIM_TIME_STEP, fov);
+					sim_accumulator = 0.0;
+				}
+				while (sim_accumulator >= SIM_TIME_STEP)
+				{
+					ProcessInput();
+					m_graphics->Update(SIM_TIME_STEP, fov);
+					sim_accumulator -= SIM_TIME_STEP;
+				}
+			}
+
+			render_stats.Reset();
+			Display(m_window->getWindow(), m_BENCHMARK ? 1.0 : sim_accumulator / SIM_TIME_STEP);
+			debug_output.Flush(std::cerr);
+			if (m_BENCHMARK) { frame_draw_calls.push_back(render_stats.getFrame().draw_calls); }
 			glfwPollEvents();
+			profiler.EndMarker();
+
+			m_frame_count++;
+			if (m_frame_limit > 0 && m_frame_count >= m_frame_limit)
+			{
+				glfwSetWindowShouldClose(m_window->getWindow(), true);
+			}
 		}
 
 		m_running = false;
+		profiler.PrintReport(std::cout);
+		memory_tracker.PrintReport(std::cout);
+		if (m_BENCHMARK) { WriteBenchmarkReport(m_benchmark_report); }
+	}
+
+	void UpdateBenchmark()
+	{ //Stands in for ProcessInput, the camera follows the path and stops at each planet along the way
+		float path_time = (float)(m_frame_count * SIM_TIME_STEP);
+		const std::vector<CameraPath::Visit>& visits = m_benchmark_path->getVisits();
+
+		if (benchmark_visit < visits.size())
+		{
+			const CameraPath::Visit& visit = visits[benchmark_visit];
+			if (!m_graphics->isVisiting() && path_time >= visit.time) { m_graphics->visitPlanet(visit.planet); }
+			else if (m_graphics->isVisiting() && path_time >= visit.time + visit.duration)
+			{
+				m_graphics->visitPlanet();
+				benchmark_visit++;
+			}
+		}
+
+		if (!m_graphics->isVisiting())
+		{
+			glm::vec3 position, target;
+			m_benchmark_path->Evaluate(path_time, position, target);
+			m_graphics->setCameraPose(position, target);
+		}
 	}
 
-	void Display(GLFWwindow* window, double time)
+	bool WriteBenchmarkReport(const std::string& file_path)
+	{ //JSON so reports from different builds can be diffed
+		std::ofstream report_file(file_path);
+		if (!report_file.is_open())
+		{
+			std::cerr << "Error: Could not Open File!\n" << file_path << std::endl;
+			return false;
+		}
+
+		std::vector<double> sorted_times = frame_times;
+		std::sort(sorted_times.begin(), sorted_times.end());
+		auto percentile = [&sorted_times](double p)
+		{
+			if (sorted_times.empty()) { return 0.0; }
+			return sorted_times[std::min(sorted_times.size() - 1, (size_t)(p * sorted_times.size()))];
+		};
+
+		double total_time = 0.0;
+		for (double frame_time : frame_times) { total_time += frame_time; }
+
+		unsigned long long total_draw_calls = 0;
+		unsigned int max_draw_calls = 0;
+		for (unsigned int draw_calls : frame_draw_calls)
+		{
+			total_draw_calls += draw_calls;
+			max_draw_calls = std::max(max_draw_calls, draw_calls);
+		}
+
+		report_file << std::fixed << std::setprecision(3);
+		report_file << "{\n";
+		report_file << "  \"seed\": " << BENCHMARK_SEED << ",\n";
+		report_file << "  \"shading\": \"" << (m_DEFERRED ? "deferred" : "forward") << "\",\n";
+		report_file << "  \"depth_prepass\": " << (m_DEPTH_PREPASS ? "true" : "false") << ",\n";
+		report_file << "  \"shadows\": " << (m_SHADOWS ? m_shadow_filter : -1) << ",\n";
+		report_file << "  \"resolution\": [" << m_window->getWindowWidth() << ", " << m_window->getWindowHeight() << "],\n";
+		report_file << "  \"frames\": " << m_frame_count << ",\n";
+		report_file << "  \"startup_ms\": " << startup_time << ",\n";
+		report_file << "  \"shader_startup\": { \"ms\": " << m_graphics->getShaderStartupTime() << ", \"cache\": \""
+			<< (m_graphics->isShaderCacheWarm() ? "warm" : "cold") << "\" },\n";
+		report_file << "  \"texture_streaming\": { \"enabled\": false, \"last_upload_ms\": " //Always off in benchmarks, textures are flushed before the first frame
+			<< texture_streamer.getLastUploadTime() << ", \"uploaded_bytes\": " << texture_streamer.getUploadedBytes() << " },\n";
+		report_file << "  \"frame_ms\": {\n";
+		report_file << "    \"avg\": " << (frame_times.empty() ? 0.0 : total_time / frame_times.size()) << ",\n";
+		report_file << "    \"p50\": " << percentile(0.50) << ",\n";
+		report_file << "    \"p95\": " << percentile(0.95) << ",\n";
+		report_file << "    \"p99\": " << percentile(0.99) << ",\n";
+		report_file << "    \"max\": " << (sorted_times.empty() ? 0.0 : sorted_times.back()) << "\n";
+		report_file << "  },\n";
+		report_file << "  \"draw_calls\": {\n";
+		report_file << "    \"avg\": " << (frame_draw_calls.empty() ? 0.0 : (double)total_draw_calls / frame_draw_calls.size()) << ",\n";
+		report_file << "    \"max\": " << max_draw_calls << ",\n";
+		report_file << "    \"total\": " << total_draw_calls << "\n";
+		report_file << "  },\n";
+		//The lit belt draws include fragment shading, only the --vertex-probe draws with rasterization off time the vertex
+		//shader alone. The post transform cache runs it somewhere between once per unique vertex and once per index.
+		//The inverse draw is the per vertex transpose(inverse()) the supplied normal matrices replaced, for before and after.
+		Profiler::Stats asteroid_gpu = profiler.getGpuStats("Asteroid Instancing");
+		Profiler::Stats vertex_gpu = profiler.getGpuStats("Asteroid Vertices");
+		Profiler::Stats inverse_gpu = profiler.getGpuStats("Asteroid Vertices Inverse");
+		unsigned long long asteroid_vertices = m_graphics->getAsteroidVertexCount();
+		report_file << "  \"asteroid_belts\": {\n";
+		report_file << "    \"instances\": " << m_ASTEROID_COUNT << ",\n";
+		report_file << "    \"unique_vertices\": " << asteroid_vertices << ",\n";
+		report_file << "    \"indices\": " << m_graphics->getAsteroidIndexCount() << ",\n";
+		report_file << "    \"lit_gpu_ms\": " << asteroid_gpu.avg << ",\n";
+		if (m_VERTEX_PROBE)
+		{
+			report_file << "    \"vertex_only_gpu_ms\": " << vertex_gpu.avg << ",\n";
+			report_file << "    \"million_unique_vertices_per_ms\": " << (vertex_gpu.avg > 0.0 ? asteroid_vertices / vertex_gpu.avg / 1000000.0 : 0.0) << ",\n";
+			report_file << "    \"per_vertex_inverse_gpu_ms\": " << inverse_gpu.avg << ",\n";
+			report_file << "    \"per_vertex_inverse_million_unique_vertices_per_ms\": " << (inverse_gpu.avg > 0.0 ? asteroid_vertices / inverse_gpu.avg / 1000000.0 : 0.0) << "\n";
+		}
+		else
+		{
+			report_file << "    \"vertex_only_gpu_ms\": null,\n";
+			report_file << "    \"million_unique_vertices_per_ms\": null,\n";
+			report_file << "    \"per_vertex_inverse_gpu_ms\": null,\n";
+			report_file << "    \"per_vertex_inverse_million_unique_vertices_per_ms\": null\n";
+		}
+		report_file << "  },\n";
+		report_file << "  \"gpu_memory_bytes\": {\n";
+		report_file << "    \"resident\": " << memory_tracker.getResidentBytes() << ",\n";
+		report_file << "    \"peak\": " << memory_tracker.getPeakBytes() << "\n";
+		report_file << "  }\n";
+		report_file << "}\n";
+		report_file.close();
+
+		std::cout << "Saved benchmark report to: " << file_path << std::endl;
+		return true;
+	}
+
+	void Display(GLFWwindow* window, double interpolation)
 	{
-		m_graphics->Update(time, fov);
+		m_graphics->Interpolate((float)interpolation);
 		m_graphics->Render();
+
+		if (capture_requested || m_frame_count == m_capture_frame)
+		{ //Read back before swapping, the back buffer is undefined afterwards
+			if (m_window->SaveFrame(m_capture_path)) { std::cout << "Saved frame to: " << m_capture_path << std::endl; }
+			capture_requested = false;
+		}
 		m_window->Swap();
 	}
 
@@ -182,6 +507,82 @@ public:
 			m_graphics->setZoomDistance(zoom_amount);
 		}
 
+		//Capture Frame
+		if (glfwGetKey(m_window->getWindow(), GLFW_KEY_F12) == GLFW_PRESS && !capture_pressed)
+		{
+			CaptureFrame();
+			capture_pressed = true;
+		}
+		else if (glfwGetKey(m_window->getWindow(), GLFW_KEY_F12) == GLFW_RELEASE)
+		{
+			capture_pressed = false;
+		}
+
+		//Render Statistics Overlay
+		if (glfwGetKey(m_window->getWindow(), GLFW_KEY_F3) == GLFW_PRESS && !stats_pressed)
+		{
+			m_graphics->toggleStatsOverlay();
+			stats_pressed = true;
+		}
+		else if (glfwGetKey(m_window->getWindow(), GLFW_KEY_F3) == GLFW_RELEASE)
+		{
+			stats_pressed = false;
+		}
+
+		//Dynamic Resolution
+		if (glfwGetKey(m_window->getWindow(), GLFW_KEY_F4) == GLFW_PRESS && !resolution_pressed)
+		{
+			m_graphics->toggleDynamicResolution();
+			resolution_pressed = true;
+		}
+		else if (glfwGetKey(m_window->getWindow(), GLFW_KEY_F4) == GLFW_RELEASE)
+		{
+			resolution_pressed = false;
+		}
+
+		//Forward or Deferred Shading
+		if (glfwGetKey(m_window->getWindow(), GLFW_KEY_F5) == GLFW_PRESS && !shading_pressed)
+		{
+			m_graphics->toggleDeferredShading();
+			shading_pressed = true;
+		}
+		else if (glfwGetKey(m_window->getWindow(), GLFW_KEY_F5) == GLFW_RELEASE)
+		{
+			shading_pressed = false;
+		}
+
+		//Depth Pre-Pass
+		if (glfwGetKey(m_window->getWindow(), GLFW_KEY_F6) == GLFW_PRESS && !prepass_pressed)
+		{
+			m_graphics->toggleDepthPrepass();
+			prepass_pressed = true;
+		}
+		else if (glfwGetKey(m_window->getWindow(), GLFW_KEY_F6) == GLFW_RELEASE)
+		{
+			prepass_pressed = false;
+		}
+
+		//Shadows and their filter quality
+		if (glfwGetKey(m_window->getWindow(), GLFW_KEY_F7) == GLFW_PRESS && !shadows_pressed)
+		{
+			m_graphics->toggleShadows();
+			shadows_pressed = true;
+		}
+		else if (glfwGetKey(m_window->getWindow(), GLFW_KEY_F7) == GLFW_RELEASE)
+		{
+			shadows_pressed = false;
+		}
+
+		if (glfwGetKey(m_window->getWindow(), GLFW_KEY_F8) == GLFW_PRESS && !shadow_filter_pressed)
+		{
+			m_graphics->cycleShadowFilter();
+			shadow_filter_pressed = true;
+		}
+		else if (glfwGetKey(m_window->getWindow(), GLFW_KEY_F8) == GLFW_RELEASE)
+		{
+			shadow_filter_pressed = false;
+		}
+
 		//Exit Window
 		if (glfwGetKey(m_window->getWindow(), GLFW_KEY_ESCAPE) == GLFW_PRESS)
 		{
@@ -193,6 +594,19 @@ public:
 void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods)
 {
 	//get keys!
+	if (key == GLFW_KEY_F9 && action == GLFW_PRESS) //Toggle profiler trace capture
+	{
+		if (profiler.isCapturing()) { profiler.StopCapture("profile_trace.json"); }
+		else { profiler.StartCapture(); }
+	}
+	if (key == GLFW_KEY_F10 && action == GLFW_PRESS) //Print profiler report
+	{
+		profiler.PrintReport(std::cout);
+	}
+	if (key == GLFW_KEY_F11 && action == GLFW_PRESS) //Print GPU memory report
+	{
+		memory_tracker.PrintReport(std::cout);
+	}
 }
 
 void scroll_callback(GLFWwindow* window, double xoffset, double yoffset)
@@ -0,0 +1,312 @@
+#pragma once
+#ifndef FRAME_GRAPH_H
+#define FRAME_GRAPH_H
+
+#include "Main_Header.h"
+#include "Profiler.h"
+#include "Render_Stats.h"
+#include "Debug_Output.h"
+#include "Memory_Tracker.h"
+
+class FrameGraph
+{
+public:
+	typedef int Resource;
+
+	struct TextureDesc
+	{
+		int width;
+		int height;
+		GLenum internal_format;
+
+		bool operator==(const TextureDesc& other) const
+		{
+			return width == other.width && height == other.height && internal_format == other.internal_format;
+		}
+	};
+
+	class Builder
+	{
+	private:
+		FrameGraph& graph;
+		unsigned int pass;
+
+	public:
+		Builder(FrameGraph& graph, unsigned int pass) : graph(graph), pass(pass) {}
+
+		//New transient texture, it only exists from the first pass using it to the last
+		Resource Create(const std::string& name, const TextureDesc& desc)
+		{
+			Resource resource = graph.resources.size();
+			graph.resources.push_back({ name, desc, false, 0, -1 });
+			return Write(resource);
+		}
+
+		Resource Read(Resource resource)
+		{
+			if (graph.resources[resource].writers == 0)
+			{
+				std::cerr << "Error: Frame graph pass " << graph.passes[pass].name << " reads " << graph.resources[resource].name << " before anything writes it!" << std::endl;
+			}
+			graph.passes[pass].reads.push_back(resource);
+			return resource;
+		}
+
+		Resource Write(Resource resource)
+		{
+			graph.resources[resource].writers++;
+			graph.passes[pass].writes.push_back(resource);
+			return resource;
+		}
+	};
+
+private:
+	struct ResourceNode
+	{
+		std::string name;
+		TextureDesc desc;
+		bool imported; //Owned outside the graph, like the back buffer, writing to it keeps a pass alive
+		unsigned int writers;
+		int physical; //Pool texture backing this resource for the current frame
+		unsigned int framebuffer = 0; //Only for imported resources
+	};
+
+	struct PassNode
+	{
+		std::string name;
+		std::vector<Resource> reads;
+		std::vector<Resource> writes;
+		std::function<void(FrameGraph&)> execute;
+		bool culled = false;
+	};
+
+	struct PhysicalTexture
+	{
+		TextureDesc desc;
+		unsigned int texture;
+		bool in_use;
+	};
+
+	std::vector<ResourceNode> resources;
+	std::vector<PassNode> passes;
+
+	//Kept between frames, the same graph maps onto the same textures and framebuffers every frame
+	std::vector<PhysicalTexture> pool;
+	std::map<std::vector<unsigned int>, unsigned int> framebuffers; //Keyed by attached pool textures
+
+	static bool isDepthFormat(GLenum internal_format)
+	{
+		return internal_format == GL_DEPTH24_STENCIL8 || internal_format == GL_DEPTH_COMPONENT24 || internal_format == GL_DEPTH_COMPONENT32F;
+	}
+
+	static int bytesPerTexel(GLenum internal_format)
+	{
+		switch (internal_format)
+		{
+		case GL_RGBA16F: return 8;
+		case GL_R16F: return 2;
+		case GL_RGBA32F: return 16;
+		default: return 4;
+		}
+	}
+
+	int acquireTexture(const TextureDesc& desc, const std::string& name)
+	{
+		for (unsigned int i = 0; i < pool.size(); i++)
+		{
+			if (!pool[i].in_use && pool[i].desc == desc)
+			{
+				pool[i].in_use = true;
+				return i;
+			}
+		}
+
+		PhysicalTexture physical = { desc, 0, true };
+		glGenTextures(1, &physical.texture);
+		glBindTexture(GL_TEXTURE_2D, physical.texture);
+		bool depth = isDepthFormat(desc.internal_format);
+		glTexImage2D(GL_TEXTURE_2D, 0, desc.internal_format, desc.width, desc.height, 0, depth ? GL_DEPTH_STENCIL : GL_RGBA,
+			depth ? GL_UNSIGNED_INT_24_8 : GL_FLOAT, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, depth ? GL_NEAREST : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, depth ? GL_NEAREST : GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+		//Named after the first resource it backs, later resources may alias it
+		debug_output.Label(GL_TEXTURE, physical.texture, "Frame Graph " + name);
+		memory_tracker.Allocate(GL_TEXTURE, physical.texture, MemoryTracker::RENDER_TARGET, "Frame Graph",
+			MemoryTracker::TextureBytes(desc.width, desc.height, bytesPerTexel(desc.internal_format), false));
+
+		pool.push_back(physical);
+		return pool.size() - 1;
+	}
+
+	void cull()
+	{ //Walks back from passes with side effects, anything whose writes nobody reads is dropped
+		std::vector<bool> needed(resources.size(), false);
+		for (int i = passes.size() - 1; i >= 0; i--)
+		{
+			PassNode& pass = passes[i];
+			pass.culled = true;
+			for (Resource resource : pass.writes)
+			{
+				if (resources[resource].imported || needed[resource]) { pass.culled = false; }
+			}
+			if (pass.culled) { continue; }
+
+			for (Resource resource : pass.reads) { needed[resource] = true; }
+		}
+	}
+
+	void allocate()
+	{ //Passes run in the order they were added, transient textures are handed back as soon as their last pass is done
+		std::vector<int> first_use(resources.size(), -1), last_use(resources.size(), -1);
+		for (unsigned int i = 0; i < passes.size(); i++)
+		{
+			if (passes[i].culled) { continue; }
+
+			auto touch = [&](Resource resource)
+			{
+				if (first_use[resource] < 0) { first_use[resource] = i; }
+				last_use[resource] = i;
+			};
+			for (Resource resource : passes[i].reads) { touch(resource); }
+			for (Resource resource : passes[i].writes) { touch(resource); }
+		}
+
+		for (PhysicalTexture& physical : pool) { physical.in_use = false; }
+		for (unsigned int i = 0; i < passes.size(); i++)
+		{
+			for (unsigned int r = 0; r < resources.size(); r++)
+			{
+				if (!resources[r].imported && first_use[r] == (int)i) { resources[r].physical = acquireTexture(resources[r].desc, resources[r].name); }
+			}
+			for (unsigned int r = 0; r < resources.size(); r++)
+			{
+				if (!resources[r].imported && last_use[r] == (int)i) { pool[resources[r].physical].in_use = false; }
+			}
+		}
+	}
+
+public:
+	~FrameGraph()
+	{
+		Release();
+	}
+
+	//Starts a new frame, passes and resources are declared again every frame
+	void Reset()
+	{
+		resources.clear();
+		passes.clear();
+	}
+
+	Resource ImportFramebuffer(const std::string& name, unsigned int framebuffer)
+	{
+		Resource resource = resources.size();
+		ResourceNode node = { name, TextureDesc(), true, 1, -1 };
+		node.framebuffer = framebuffer;
+		resources.push_back(node);
+		return resource;
+	}
+
+	//Texture owned outside the graph and kept between frames, passes bind it themselves
+	Resource ImportTexture(const std::string& name)
+	{
+		return ImportFramebuffer(name, 0);
+	}
+
+	void AddPass(const std::string& name, std::function<void(Builder&)> setup, std::function<void(FrameGraph&)> execute)
+	{
+		passes.push_back({ name, {}, {}, execute });
+		Builder builder(*this, passes.size() - 1);
+		setup(builder);
+	}
+
+	void Execute()
+	{
+		cull();
+		allocate();
+
+		for (PassNode& pass : passes)
+		{
+			if (pass.culled) { continue; }
+
+			profiler.BeginMarker(pass.name);
+			pass.execute(*this);
+			profiler.EndMarker();
+		}
+	}
+
+	unsigned int getTexture(Resource resource)
+	{
+		return resources[resource].imported ? 0 : pool[resources[resource].physical].texture;
+	}
+
+	//Binds a framebuffer with the given targets attached, color targets in order and at most one depth target.
+	void BindFramebuffer(const std::vector<Resource>& targets)
+	{
+		if (targets.size() == 1 && resources[targets[0]].imported)
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, resources[targets[0]].framebuffer);
+			render_stats.CountFramebuffer();
+			return;
+		}
+
+		std::vector<unsigned int> key;
+		for (Resource resource : targets) { key.push_back(getTexture(resource)); }
+
+		auto cached = framebuffers.find(key);
+		if (cached != framebuffers.end())
+		{
+			glBindFramebuffer(GL_FRAMEBUFFER, cached->second);
+			render_stats.CountFramebuffer();
+			return;
+		}
+
+		unsigned int framebuffer;
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		render_stats.CountFramebuffer();
+
+		std::string label = "Frame Graph FBO";
+		std::vector<GLenum> attachments;
+		for (Resource resource : targets)
+		{
+			label += " " + resources[resource].name;
+			if (isDepthFormat(resources[resource].desc.internal_format))
+			{
+				glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_TEXTURE_2D, getTexture(resource), 0);
+			}
+			else
+			{
+				glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + attachments.size(), GL_TEXTURE_2D, getTexture(resource), 0);
+				attachments.push_back(GL_COLOR_ATTACHMENT0 + attachments.size());
+			}
+		}
+		glDrawBuffers(attachments.size(), attachments.data());
+		debug_output.Label(GL_FRAMEBUFFER, framebuffer, label);
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << label << " not complete!" << std::endl;
+		}
+		framebuffers[key] = framebuffer;
+	}
+
+	//Drops every pooled texture and framebuffer, needed when target sizes change
+	void Release()
+	{
+		for (auto& framebuffer : framebuffers) { glDeleteFramebuffers(1, &framebuffer.second); }
+		framebuffers.clear();
+
+		for (PhysicalTexture& physical : pool)
+		{
+			memory_tracker.Free(GL_TEXTURE, physical.texture);
+			glDeleteTextures(1, &physical.texture);
+		}
+		pool.clear();
+	}
+};
+
+#endif
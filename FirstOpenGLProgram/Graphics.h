@@ -11,29 +11,26 @@
 #include "Sphere.h"
 #include "Emitter.h"
 #include "Texture.h"
+#include "Job_System.h"
+#include "Asteroid_Field.h"
+#include "Solar_System.h"
+#include "Profiler.h"
+#include "Render_Stats.h"
+#include "Debug_Output.h"
+#include "Stats_Overlay.h"
+#include "Memory_Tracker.h"
+#include "Frame_Graph.h"
+#include "Clustered_Lights.h"
+#include "Shadow_Map.h"
+#include "Shader_Manager.h"
+#include "Shader_Variants.h"
+#include "Texture_Streamer.h"
 
 float lerp(float start, float end, float f)
 {
 	return start * (1.0 - f) + (end * f);
 }
 
-std::string processShaderFile(const std::string& shader_file_name)
-{
-	std::ifstream shader_file(shader_file_name);
-
-	if (shader_file.is_open())
-	{
-		std::stringstream buffer;
-		buffer << shader_file.rdbuf();
-		shader_file.close();
-		return buffer.str();
-	}
-	else
-	{
-		return ""; //file could not be processed
-	}
-}
-
 unsigned int quadVAO = 0;
 unsigned int quadVBO;
 void renderQuad()
@@ -52,6 +49,10 @@ void renderQuad()
 		glBindVertexArray(quadVAO);
 		glBindBuffer(GL_ARRAY_BUFFER, quadVBO);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(quadVertices), &quadVertices, GL_STATIC_DRAW);
+		render_stats.CountBufferUpload(sizeof(quadVertices));
+		memory_tracker.Allocate(GL_BUFFER, quadVBO, MemoryTracker::VERTEX_BUFFER, "Screen Quad", sizeof(quadVertices));
+		debug_output.Label(GL_VERTEX_ARRAY, quadVAO, "Screen Quad VAO");
+		debug_output.Label(GL_BUFFER, quadVBO, "Screen Quad Vertices");
 
 		glEnableVertexAttribArray(0);
 		glEnableVertexAttribArray(1);
@@ -61,56 +62,42 @@ void renderQuad()
 	}
 
 	glBindVertexArray(quadVAO);
+	render_stats.CountVertexArray();
 	glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+	render_stats.CountDraw(2);
 	glBindVertexArray(0);
 }
 
-std::vector<glm::mat4> generateAsteroidMatrices(int amount, float offset, float radius)
-{
-	std::vector<glm::mat4> asteroidMatrices;
-	for (int i = 0; i < amount; i++)
-	{
-		glm::mat4 model = glm::mat4(1.0f);
-
-		//Random Translation
-		float angle = (float)(i) / (float)(amount) * 360.f;
-
-		float displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-		float x = cos(angle) * radius + displacement;
-		displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-		float z = sin(angle) * radius + displacement;
-		displacement = (rand() % (int)(2 * offset * 100)) / 100.0f - offset;
-		float y = displacement * 0.1f;
-
-		model = glm::translate(model, glm::vec3(x, y, z));
-
-		//Random Scale
-		float scale = (rand() % 6) / 10.f + 0.5f;
-		model = glm::scale(model, glm::vec3(scale));
-
-		//Random Rotation
-		float rotation_angle = (rand() % 361);
-		model = glm::rotate(model, rotation_angle, glm::vec3(0.f, 1.f, 0.f));
-
-		asteroidMatrices.push_back(model);
-	}
-	return asteroidMatrices;
-}
-
 class Graphics
 {
 private:
 	Camera* m_camera;
+	JobSystem* m_jobs;
 
 	//Shaders
-	Shader* m_shader;
 	Shader* m_light_shader;
 	Shader* m_skybox_shader;
 	Shader* m_blur_shader;
 	Shader* m_hdr_shader;
 	Shader* m_particle_shader;
+	Shader* m_sorted_particle_shader; //The particle shader writing plain alpha blended color
 	Shader* m_outline_shader;
 	Shader* m_texture_shader;
+	Shader* m_oit_composite_shader;
+	ShaderManager* m_shader_manager;
+
+	//Shader Variants, specialized by feature defines instead of branching on uniforms
+	ShaderVariants* m_scene_variants;
+	ShaderVariants* m_gbuffer_variants;
+	ShaderVariants* m_deferred_variants;
+	ShaderVariants* m_depth_variants;
+	ShaderVariants* m_shadow_variants;
+	const char* SHADER_CACHE_FILE = "shader_cache.bin";
+	bool use_shader_cache = true;
+
+	//Texture Streaming, model textures follow how large their models are on screen
+	bool texture_streaming = true;
+	const float ASTEROID_SCREEN_SIZE = 0.125f; //Of the render height, rocks are small but the camera flies through the belts
 
 	//Light Models
 	Model* m_point_light0;
@@ -132,11 +119,31 @@ private:
 	//Asteroid Instance Variables
 	Model* m_asteroid_belt1;
 	Model* m_asteroid_belt2;
+	unsigned int asteroid_count = 1500; //Across both belts, the outer one gets two thirds
+	std::vector<Asteroid_Chunk> belt1_chunks, belt2_chunks;
+	std::vector<Instance_Range> belt1_visible, belt2_visible; //Chunks in view this frame, for the camera passes only
 
 	//Misc
 	CubeMap* m_skybox;
 	Texture* m_console_texture;
 
+	//Lighting
+	ClusteredLights* m_lights;
+
+	//Shadows, the sun light casts them through a cube map around it
+	const unsigned int SUN_LIGHT = 3; //Index of m_point_light3 in m_lights
+	const int SHADOW_MAP_SIZE = 1024;
+	const float SHADOW_FAR_PLANE = 300.f; //Past the outer asteroid belt
+	const unsigned int SHADOW_MAP_UNIT = 10; //Clear of the material and G-buffer samplers
+	const unsigned int SHADOW_FILTERS = ShaderVariants::SHADOW_PCF_MEDIUM | ShaderVariants::SHADOW_PCF_SOFT;
+	ShadowMap* m_shadow_map;
+	bool shadows = true;
+	ShadowMap::Filter shadow_filter = ShadowMap::PCF_MEDIUM; //Compiled into the lit variants, switching it switches programs
+
+	//Render Statistics
+	StatsOverlay* m_stats_overlay;
+	bool show_stats = false;
+
 	//Procedural Models
 
 	//Particle Emitters
@@ -145,26 +152,45 @@ private:
 	Emitter* m_sun_particle;
 	Emitter* m_ship_particle;
 	Emitter* m_comet_particle;
+	JobSystem::Job* particle_sort = NULL; //Back to front sort of the SORTED emitters, started at the top of Render
 
 	//Transformations
 	glm::mat4 player_tmat;
 	glm::mat4 player_rmat;
 	glm::mat4 player_smat;
 
-	glm::mat4 tmat;
-	glm::mat4 rmat;
-	glm::mat4 smat;
 	glm::mat4 t_offset;
 	glm::mat4 r_offset;
 	std::stack<std::pair<std::string, glm::mat4>> planet_stack;
 
 	//Frame Buffers
-	unsigned int hdrFBO;
-	unsigned int pingpongFBO[2];
-	unsigned int colorBuffers[2];
-	unsigned int pingpongColorBuffers[2];
-	unsigned int rboDepth;
-	unsigned int rboStencil;
+	FrameGraph* m_frame_graph;
+	unsigned int output_framebuffer = 0; //Back buffer, or the offscreen target when running headless
+
+	//Dynamic Resolution, the scene and bloom render into the corner of the scene targets and the HDR resolve scales them
+	//to the screen. By default the scale only drops below 1 and the targets are screen sized. With supersampling on, an
+	//under budget scene goes up to SUPERSAMPLE_SCALE, and every scaled target is allocated at that size up front.
+	const float MIN_RENDER_SCALE = 0.5f;
+	const float SUPERSAMPLE_SCALE = 1.5f; //2.25x the pixels, so 2.25x the memory of every scaled target
+	float max_render_scale = 1.f; //Largest scale reachable, the scene targets are sized for it
+	const float RENDER_SCALE_GAIN = 0.1f; //GPU times arrive a few frames late, small steps keep the scale from oscillating
+	bool dynamic_resolution = false;
+	float gpu_budget_ms = 14.f;
+	float render_scale = 1.f;
+	unsigned long long render_gpu_sample = 0; //Last GPU sample the scale reacted to
+	int render_width;
+	int render_height;
+	int target_width = 0; //Size of the scene targets, room for max_render_scale
+	int target_height = 0;
+
+	//Deferred Shading, opaque models write a G-buffer and are lit once per pixel instead of once per covered fragment
+	bool deferred_shading = false;
+
+	//Depth Pre-Pass, lays down depth with a position only shader so the lit pass only shades visible fragments
+	bool depth_prepass = false;
+
+	//Draws the asteroid belts again with rasterization off, so a GPU marker times their vertex shading alone
+	bool vertex_probe = false;
 
 	//Player Ship
 	int screen_width;
@@ -182,10 +208,17 @@ private:
 
 	glm::mat4 player_mat;
 
+	//Ship Particles
+	glm::mat4 particle_ship_origin;
+	glm::vec3 particle_ship_velocity;
+
 	//Visting
 	const float SELECT_PLANET_RANGE = 65.f;
-	bool can_visit;
-	bool visiting;
+	const int OUTLINE_STENCIL = 2; //Opaque models write 1, the selected planet writes this instead
+	const int OUTLINE_WIDTH = 2; //Pixels at full render scale
+	bool can_visit = false;
+	Model* selected_planet = NULL;
+	bool visiting = false;
 	std::pair<std::string, float> closest_planet;
 	glm::vec3 temp_camera_pos;
 	glm::vec3 temp_camera_rot;
@@ -193,50 +226,60 @@ private:
 	float mouse_pitch;
 	float zoom_distance;
 
+	//Random seed, fixed for reproducible runs
+	bool use_fixed_seed = false;
+	unsigned int fixed_seed = 0;
+
+	//Simulation clock, advanced by the fixed step passed to Update
+	double sim_time = 0.0;
+	double sim_step = 0.0;
+	float render_time = 0.f;
+
 	void setShaderLights(Shader *shader)
 	{
-		glUniform3fv(shader->GetUniformLocation("dir_light.direction"), 1, glm::value_ptr(glm::vec3(0.f, 0.f, 0.f)));
-		glUniform3fv(shader->GetUniformLocation("dir_light.ambient"), 1, glm::value_ptr(glm::vec3(0.f, 0.f, 0.f)));
-		glUniform3fv(shader->GetUniformLocation("dir_light.diffuse"), 1, glm::value_ptr(glm::vec3(0.f, 0.f, 0.f)));
-		glUniform3fv(shader->GetUniformLocation("dir_light.specular"), 1, glm::value_ptr(glm::vec3(0.f, 0.f, 0.f)));
+		uploadUniform(glUniform3fv, shader->GetUniformLocation("dir_light.direction"), 1, glm::value_ptr(glm::vec3(0.f, 0.f, 0.f)));
+		uploadUniform(glUniform3fv, shader->GetUniformLocation("dir_light.ambient"), 1, glm::value_ptr(glm::vec3(0.f, 0.f, 0.f)));
+		uploadUniform(glUniform3fv, shader->GetUniformLocation("dir_light.diffuse"), 1, glm::value_ptr(glm::vec3(0.f, 0.f, 0.f)));
+		uploadUniform(glUniform3fv, shader->GetUniformLocation("dir_light.specular"), 1, glm::value_ptr(glm::vec3(0.f, 0.f, 0.f)));
+	}
 
-		glUniform3fv(shader->GetUniformLocation("point_lights[0].ambient"), 1, glm::value_ptr(glm::vec3(.1f, .1f, .1f)));
-		glUniform3fv(shader->GetUniformLocation("point_lights[0].diffuse"), 1, glm::value_ptr(glm::vec3(5.f, 5.f, 10.f)));
-		glUniform3fv(shader->GetUniformLocation("point_lights[0].specular"), 1, glm::value_ptr(glm::vec3(1.f, 1.f, 1.f)));
-		glUniform1f(shader->GetUniformLocation("point_lights[0].constant"), 0.25f);
-		glUniform1f(shader->GetUniformLocation("point_lights[0].linear"), 0.09f);
-		glUniform1f(shader->GetUniformLocation("point_lights[0].quadratic"), 0.032f);
+	void addPointLights()
+	{ //Added in the order of m_point_light0 to m_point_light3, their positions follow those models every frame
+		m_lights->AddLight({ glm::vec3(0.f), glm::vec3(.1f, .1f, .1f), glm::vec3(5.f, 5.f, 10.f), glm::vec3(1.f, 1.f, 1.f), 0.25f, 0.09f, 0.032f });
 
 		//Player Engine Lights
-		glUniform3fv(shader->GetUniformLocation("point_lights[1].ambient"), 1, glm::value_ptr(glm::vec3(0.25f, 0.25f, 0.25f)));
-		glUniform3fv(shader->GetUniformLocation("point_lights[1].diffuse"), 1, glm::value_ptr(glm::vec3(1.f, 1.f, 2.f)));
-		glUniform3fv(shader->GetUniformLocation("point_lights[1].specular"), 1, glm::value_ptr(glm::vec3(.4f, .4f, .4f)));
-		glUniform1f(shader->GetUniformLocation("point_lights[1].constant"), 1.5f);
-		glUniform1f(shader->GetUniformLocation("point_lights[1].linear"), 0.3f);
-		glUniform1f(shader->GetUniformLocation("point_lights[1].quadratic"), 0.05f);
-
-		glUniform3fv(shader->GetUniformLocation("point_lights[2].ambient"), 1, glm::value_ptr(glm::vec3(0.25f, 0.25f, 0.25f)));
-		glUniform3fv(shader->GetUniformLocation("point_lights[2].diffuse"), 1, glm::value_ptr(glm::vec3(1.f, 1.f, 2.f)));
-		glUniform3fv(shader->GetUniformLocation("point_lights[2].specular"), 1, glm::value_ptr(glm::vec3(.4f, .4f, .4f)));
-		glUniform1f(shader->GetUniformLocation("point_lights[2].constant"), 1.5f);
-		glUniform1f(shader->GetUniformLocation("point_lights[2].linear"), 0.3f);
-		glUniform1f(shader->GetUniformLocation("point_lights[2].quadratic"), 0.05f);
+		m_lights->AddLight({ glm::vec3(0.f), glm::vec3(0.25f, 0.25f, 0.25f), glm::vec3(1.f, 1.f, 2.f), glm::vec3(.4f, .4f, .4f), 1.5f, 0.3f, 0.05f });
+
+		m_lights->AddLight({ glm::vec3(0.f), glm::vec3(0.25f, 0.25f, 0.25f), glm::vec3(1.f, 1.f, 2.f), glm::vec3(.4f, .4f, .4f), 1.5f, 0.3f, 0.05f });
 
 		//Sun Light
-		glUniform3fv(shader->GetUniformLocation("point_lights[3].ambient"), 1, glm::value_ptr(glm::vec3(.22f, .35f, .7f)));
-		glUniform3fv(shader->GetUniformLocation("point_lights[3].diffuse"), 1, glm::value_ptr(glm::vec3(9.5f, 6.6f, 2.f)));
-		glUniform3fv(shader->GetUniformLocation("point_lights[3].specular"), 1, glm::value_ptr(glm::vec3(.97f, .95f, .72f)));
-		glUniform1f(shader->GetUniformLocation("point_lights[3].constant"), 0.1f);
-		glUniform1f(shader->GetUniformLocation("point_lights[3].linear"), 0.02f);
-		glUniform1f(shader->GetUniformLocation("point_lights[3].quadratic"), 0.00025f);
+		m_lights->AddLight({ glm::vec3(0.f), glm::vec3(.22f, .35f, .7f), glm::vec3(9.5f, 6.6f, 2.f), glm::vec3(.97f, .95f, .72f), 0.1f, 0.02f, 0.00025f });
 	}
 
 public:
+	~Graphics()
+	{
+		delete m_jobs;
+		m_jobs = NULL;
+	}
+
 	bool Initialize(int width, int height)
 	{
 		screen_width = width;
 		screen_height = height;
 
+		//Initialize Jobs
+		m_jobs = new JobSystem();
+		if (!m_jobs->Initialize())
+		{
+			std::cerr << "Error: Job System Could Not Initialize!\n" << std::endl;
+			return false;
+		}
+
+		//Textures load in the background from here on, the first frame draws with placeholders
+		texture_streamer.setFullDetail(!texture_streaming);
+		texture_streamer.Initialize();
+
 		GLuint VAO;
 		GLuint light_VAO;
 
@@ -255,59 +298,76 @@ public:
 		}
 
 		//Initialize Shaders
-		m_shader = new Shader();
 		m_light_shader = new Shader();
 		m_skybox_shader = new Shader();
 		m_blur_shader = new Shader;
 		m_hdr_shader = new Shader();
 		m_particle_shader = new Shader();
+		m_sorted_particle_shader = new Shader();
 		m_outline_shader = new Shader();
 		m_texture_shader = new Shader();
+		m_oit_composite_shader = new Shader();
 
 		std::map<Shader*, std::pair<std::string, std::string>> shader_map
 		{
-			{m_shader, {"shaders/vertex/v_shader.txt", "shaders/fragment/f_shader.txt"}},
 			{m_light_shader, {"shaders/vertex/v_light_shader.txt", "shaders/fragment/f_light_shader.txt"}},
 			{m_skybox_shader, {"shaders/vertex/v_cube_map_shader.txt", "shaders/fragment/f_cube_map_shader.txt"}},
 			{m_blur_shader, {"shaders/vertex/v_hdr_shader.txt", "shaders/fragment/f_blur_shader.txt"}},
 			{m_hdr_shader, {"shaders/vertex/v_hdr_shader.txt", "shaders/fragment/f_hdr_shader.txt"}},
 			{m_particle_shader, {"shaders/vertex/v_particle_shader.txt", "shaders/fragment/f_particle_shader.txt"}},
-			{m_outline_shader, {"shaders/vertex/v_outline_shader.txt", "shaders/fragment/f_outline_shader.txt"}},
-			{m_texture_shader, {"shaders/vertex/v_hdr_shader.txt", "shaders/fragment/f_texture_shader.txt"}}
+			{m_outline_shader, {"shaders/vertex/v_hdr_shader.txt", "shaders/fragment/f_outline_shader.txt"}},
+			{m_texture_shader, {"shaders/vertex/v_hdr_shader.txt", "shaders/fragment/f_texture_shader.txt"}},
+			{m_oit_composite_shader, {"shaders/vertex/v_hdr_shader.txt", "shaders/fragment/f_oit_composite_shader.txt"}}
 		};
 
+		//Programs linked on an earlier run come back from the cache, the rest are compiled and added to it
+		m_shader_manager = new ShaderManager();
+		m_shader_manager->setCache(use_shader_cache);
 		for (const auto& shader_entry : shader_map)
 		{
-			Shader* target_shader = shader_entry.first;
-			const auto& shader_source = shader_entry.second;
+			m_shader_manager->Add(shader_entry.first, shader_entry.second.first, shader_entry.second.second);
+		}
+		m_shader_manager->Add(m_sorted_particle_shader, "shaders/vertex/v_particle_shader.txt", "shaders/fragment/f_particle_shader.txt", { "SORTED" });
+
+		//Variants every frame needs are built with the rest, any other combination compiles the first time it is drawn
+		m_scene_variants = new ShaderVariants(m_shader_manager, "shaders/vertex/v_shader.txt", "shaders/fragment/f_shader.txt",
+			ShaderVariants::INSTANCED | ShaderVariants::EMISSIVE | ShaderVariants::NORMAL_MAP | ShaderVariants::SHADOWS | SHADOW_FILTERS | ShaderVariants::NORMAL_INVERSE);
+		m_gbuffer_variants = new ShaderVariants(m_shader_manager, "shaders/vertex/v_shader.txt", "shaders/fragment/f_gbuffer_shader.txt",
+			ShaderVariants::INSTANCED | ShaderVariants::EMISSIVE | ShaderVariants::NORMAL_MAP | ShaderVariants::NORMAL_INVERSE);
+		m_deferred_variants = new ShaderVariants(m_shader_manager, "shaders/vertex/v_hdr_shader.txt", "shaders/fragment/f_deferred_shader.txt", ShaderVariants::SHADOWS | SHADOW_FILTERS);
+		m_depth_variants = new ShaderVariants(m_shader_manager, "shaders/vertex/v_depth_shader.txt", "shaders/fragment/f_depth_shader.txt", ShaderVariants::INSTANCED);
+		m_shadow_variants = new ShaderVariants(m_shader_manager, "shaders/vertex/v_depth_shader.txt", "shaders/fragment/f_shadow_shader.txt", ShaderVariants::INSTANCED);
+		m_scene_variants->setDefaults([this](Shader& shader, unsigned int features) { setLightingDefaults(shader, features); });
+		m_deferred_variants->setDefaults([this](Shader& shader, unsigned int features) { setDeferredDefaults(shader, features); });
+
+		std::vector<unsigned int> model_masks = { ShaderVariants::NORMAL_MAP, ShaderVariants::NORMAL_MAP | ShaderVariants::EMISSIVE, ShaderVariants::NORMAL_MAP | ShaderVariants::INSTANCED };
+		std::vector<unsigned int> depth_masks = { 0, ShaderVariants::INSTANCED };
+		if (vertex_probe) { model_masks.push_back(ShaderVariants::NORMAL_MAP | ShaderVariants::INSTANCED | ShaderVariants::NORMAL_INVERSE); } //So the comparison draw never compiles mid run
+		m_gbuffer_variants->Prepare(model_masks);
+		m_deferred_variants->Prepare({ 0, shadowFeatures() });
+		m_depth_variants->Prepare(depth_masks);
+		m_shadow_variants->Prepare(depth_masks);
+		for (unsigned int mask : model_masks)
+		{
+			m_scene_variants->Prepare({ mask, mask | shadowFeatures() });
+		}
 
-			if (!target_shader->Initialize())
-			{
-				std::cerr << "Error: Shader Could Not Initialize!\n" << std::endl;
-				return false;
-			}
-			if (!target_shader->AddShader(GL_VERTEX_SHADER, processShaderFile(shader_source.first).c_str()))
-			{
-				std::cerr << "Error: Vertex Shader Could Not Initialize!\n" << std::endl;
-				return false;
-			}
-			if (!target_shader->AddShader(GL_FRAGMENT_SHADER, processShaderFile(shader_source.second).c_str()))
-			{
-				std::cerr << "Error: Fragment Shader Could Not Initialize!\n" << std::endl;
-				return false;
-			}
-			if (!target_shader->Finalize())
-			{
-				std::cerr << "Error: Shader Program Failed to Finialize!\n" << std::endl;
-				return false;
-			}
+		if (!m_shader_manager->Build(SHADER_CACHE_FILE))
+		{
+			std::cerr << "Error: Shaders Could Not Initialize!\n" << std::endl;
+			return false;
 		}
+		m_shader_manager->setReloadCallback([this](Shader* shader) { setShaderDefaults(shader); });
 
-		srand(time(0)); //Update seed of random number generator based on current time.
+		srand(use_fixed_seed ? fixed_seed : time(0)); //Update seed of random number generator based on current time.
 
 		//-------------------- Asteroids
-		m_asteroid_belt1 = new Model("models/asteroid/asteroid.obj", generateAsteroidMatrices(500, 15.f, 125.f));
-		m_asteroid_belt2 = new Model("models/asteroid/asteroid.obj", generateAsteroidMatrices(1000, 30.f, 225.f));
+		std::vector<Orbit_Instance> belt1_orbits = generateAsteroidOrbits(asteroid_count / 3, 15.f, 125.f, rand(), m_jobs);
+		std::vector<Orbit_Instance> belt2_orbits = generateAsteroidOrbits(asteroid_count - asteroid_count / 3, 30.f, 225.f, rand(), m_jobs);
+		belt1_chunks = chunkAsteroidOrbits(belt1_orbits);
+		belt2_chunks = chunkAsteroidOrbits(belt2_orbits);
+		m_asteroid_belt1 = new Model("models/asteroid/asteroid.obj", std::move(belt1_orbits));
+		m_asteroid_belt2 = new Model("models/asteroid/asteroid.obj", std::move(belt2_orbits));
 		
 		//-------------------- Solar System
 		glm::vec3 axis;
@@ -372,16 +432,42 @@ public:
 		m_engine_particle2->Initialize("textures/smoke.png", 20, 1, 20, .02f, 1.f);
 		m_sun_particle = new Emitter();
 		m_sun_particle->Initialize("textures/flame.png", 50, 1, 10, 30.f, .8f);
+		m_sun_particle->setBlending(Emitter::ADDITIVE);
 		m_ship_particle = new Emitter();
 		m_ship_particle->Initialize("textures/smoke.png", 100, 1, 15, .2f, 1.f);
 		m_ship_particle->useWorldSpace();
+		m_ship_particle->setBlending(Emitter::SORTED); //The trail is long and seen end on, weighted blending smears its layers
 		m_comet_particle = new Emitter();
 		m_comet_particle->Initialize("textures/flame.png", 100, 1, 30, .5f, 3.f);
+		m_comet_particle->setBlending(Emitter::ADDITIVE);
 		m_comet_particle->useWorldSpace();
 
 		//Onscreen Textures
 		m_console_texture = new Texture();
 		m_console_texture->Initialize("textures/spaceship_cockpit.png");
+		if (!texture_streaming) { texture_streamer.Flush(); }
+
+		m_lights = new ClusteredLights();
+		if (!m_lights->Initialize())
+		{
+			std::cerr << "Error: Clustered Lights Could Not Initialize!\n" << std::endl;
+			return false;
+		}
+		addPointLights();
+
+		m_shadow_map = new ShadowMap();
+		if (!m_shadow_map->Initialize(SHADOW_MAP_SIZE, SHADOW_FAR_PLANE))
+		{
+			std::cerr << "Error: Shadow Map Could Not Initialize!\n" << std::endl;
+			return false;
+		}
+
+		m_stats_overlay = new StatsOverlay();
+		if (!m_stats_overlay->Initialize())
+		{
+			std::cerr << "Error: Stats Overlay Could Not Initialize!\n" << std::endl;
+			return false;
+		}
 
 		//OpenGL Global Settings
 		glEnable(GL_DEPTH_TEST);
@@ -394,252 +480,838 @@ public:
 		glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
 
 		//-------------------- Frame Buffers
-		glGenFramebuffers(1, &hdrFBO);
-		glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-		glGenTextures(2, colorBuffers);
+		m_frame_graph = new FrameGraph(); //Render targets are created by the frame graph on first use
 
-		for (unsigned int i = 0; i < 2; i++)
+		//Shader Settings
+		Shader* configured_shaders[] = { m_blur_shader, m_hdr_shader, m_oit_composite_shader };
+		for (Shader* shader : configured_shaders)
 		{
-			glBindTexture(GL_TEXTURE_2D, colorBuffers[i]);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, screen_width, screen_height, 0, GL_RGBA, GL_FLOAT, NULL);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			setShaderDefaults(shader);
+		}
+		m_scene_variants->ApplyDefaults();
+		m_deferred_variants->ApplyDefaults();
 
-			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, colorBuffers[i], 0);
+		return true;
+	}
+
+	//Uniforms that are set once rather than every frame, applied again when hot reload swaps in a new program
+	void setShaderDefaults(Shader* shader)
+	{
+		shader->Enable();
+		if (shader == m_blur_shader)
+		{
+			uploadUniform(glUniform1i, m_blur_shader->GetUniformLocation("image"), 0);
+		}
+		else if (shader == m_hdr_shader)
+		{
+			uploadUniform(glUniform1i, m_hdr_shader->GetUniformLocation("scene"), 0);
+			uploadUniform(glUniform1i, m_hdr_shader->GetUniformLocation("bloomBlur"), 1);
 		}
+		else if (shader == m_oit_composite_shader)
+		{
+			uploadUniform(glUniform1i, m_oit_composite_shader->GetUniformLocation("accumulation"), 0);
+			uploadUniform(glUniform1i, m_oit_composite_shader->GetUniformLocation("revealage"), 1);
+		}
+	}
+
+	//Variant features of a shadowed lit pass, the filter quality is compiled in rather than branched on per fragment
+	unsigned int shadowFeatures()
+	{
+		static const unsigned int filter_features[ShadowMap::FILTER_COUNT] = { 0, ShaderVariants::SHADOW_PCF_MEDIUM, ShaderVariants::SHADOW_PCF_SOFT };
+		return ShaderVariants::SHADOWS | filter_features[shadow_filter];
+	}
+
+	//One time uniforms of the lit variants, the forward scene shader and the deferred lighting shader
+	void setLightingDefaults(Shader& shader, unsigned int features)
+	{
+		setShaderLights(&shader);
+		if (features & ShaderVariants::SHADOWS)
+		{ //A cube sampler left on unit 0 would clash with the material textures
+			uploadUniform(glUniform1i, shader.GetUniformLocation("shadow_map"), SHADOW_MAP_UNIT);
+		}
+	}
+
+	void setDeferredDefaults(Shader& shader, unsigned int features)
+	{
+		setLightingDefaults(shader, features);
+		uploadUniform(glUniform1i, shader.GetUniformLocation("gbuffer_albedo"), 0);
+		uploadUniform(glUniform1i, shader.GetUniformLocation("gbuffer_normal"), 1);
+		uploadUniform(glUniform1i, shader.GetUniformLocation("gbuffer_specular"), 2);
+		uploadUniform(glUniform1i, shader.GetUniformLocation("gbuffer_emission"), 3);
+		uploadUniform(glUniform1i, shader.GetUniformLocation("gbuffer_depth"), 4);
+	}
 
-		glGenRenderbuffers(1, &rboStencil);
-		glBindRenderbuffer(GL_RENDERBUFFER, rboStencil);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, screen_width, screen_height);
-		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, rboStencil);
+	void setOutputFramebuffer(unsigned int framebuffer)
+	{
+		output_framebuffer = framebuffer;
+	}
 
-		unsigned int attachements[2] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1 };
-		glDrawBuffers(2, attachements);
+	void Render()
+	{
+		m_shader_manager->Update(); //Before anything is drawn, so a frame never mixes old and new programs
+		updateRenderScale();
+		streamTextures();
+		ProfileScope render_scope("Render");
+
+		//Passes declare what they read and write, the graph drops unused passes and lets targets share memory once their last reader is done
+		FrameGraph::TextureDesc hdr_desc = { target_width, target_height, GL_RGBA16F };
+		FrameGraph::TextureDesc depth_desc = { target_width, target_height, GL_DEPTH24_STENCIL8 };
+		FrameGraph::Resource output, shadow_map, scene_color, bright, depth, blur[2];
+		glm::vec2 uv_scale = glm::vec2((float)render_width / target_width, (float)render_height / target_height);
+		glm::vec2 uv_max = uv_scale - glm::vec2(0.5f / target_width, 0.5f / target_height); //Half a texel in, so bilinear taps stay inside
+
+		m_frame_graph->Reset();
+		output = m_frame_graph->ImportFramebuffer("Output", output_framebuffer);
+
+		clusterLights();
+		cullAsteroids();
+		startParticleSort();
+		selectPlanet();
+		glClearColor(0.17, 0.12, 0.19, 1.0); //background color
+
+		if (shadows)
+		{ //Kept across frames, so it is imported rather than created by the graph
+			shadow_map = m_frame_graph->ImportTexture("Shadow Map");
+			m_frame_graph->AddPass("Shadow Map", [&](FrameGraph::Builder& builder)
+			{
+				builder.Write(shadow_map);
+			}, [&](FrameGraph& graph)
+			{
+				renderShadowMap();
+			});
+		}
 
-		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		if (deferred_shading)
 		{
-			std::cout << "Framebuffer not complete!" << std::endl;
+			FrameGraph::Resource albedo, normal, specular, emission;
+			m_frame_graph->AddPass("G-Buffer", [&](FrameGraph::Builder& builder)
+			{
+				albedo = builder.Create("G-Buffer Albedo", { target_width, target_height, GL_RGBA8 });
+				normal = builder.Create("G-Buffer Normal", { target_width, target_height, GL_RG16F });
+				specular = builder.Create("G-Buffer Specular", { target_width, target_height, GL_RGBA8 });
+				emission = builder.Create("G-Buffer Emission", hdr_desc);
+				depth = builder.Create("Depth Stencil", depth_desc);
+			}, [&](FrameGraph& graph)
+			{
+				graph.BindFramebuffer({ albedo, normal, specular, emission, depth });
+				glViewport(0, 0, render_width, render_height);
+				glStencilMask(0xFF);
+				glClear(GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT); //Pixels left at the far plane are skipped by the lighting pass
+				glDisable(GL_BLEND); //Alpha carries shininess, it must not blend
+				if (depth_prepass) { renderDepthPrepass(); }
+
+				renderOpaque(m_gbuffer_variants, 0, nullptr);
+				glEnable(GL_BLEND);
+			});
+
+			m_frame_graph->AddPass("Deferred Lighting", [&](FrameGraph::Builder& builder)
+			{
+				builder.Read(albedo);
+				builder.Read(normal);
+				builder.Read(specular);
+				builder.Read(emission);
+				builder.Read(depth);
+				if (shadows) { builder.Read(shadow_map); }
+				scene_color = builder.Create("Scene Color", hdr_desc);
+				bright = builder.Create("Bright", hdr_desc);
+			}, [&](FrameGraph& graph)
+			{ //Depth is sampled here, so it stays detached until the forward pass
+				graph.BindFramebuffer({ scene_color, bright });
+				glViewport(0, 0, render_width, render_height);
+				glClear(GL_COLOR_BUFFER_BIT);
+
+				glm::mat4 view_projection = m_camera->GetProjection() * m_camera->GetRenderView();
+				m_deferred_variants->Begin(nullptr);
+				Shader* deferred_shader = m_deferred_variants->Use(shadows ? shadowFeatures() : 0);
+				uploadUniform(glUniform3fv, deferred_shader->GetUniformLocation("view_pos"), 1, glm::value_ptr(m_camera->getRenderPosition()));
+				uploadUniform(glUniformMatrix4fv, deferred_shader->GetUniformLocation("viewMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetRenderView()));
+				uploadUniform(glUniformMatrix4fv, deferred_shader->GetUniformLocation("inverse_view_projection"), 1, GL_FALSE, glm::value_ptr(glm::inverse(view_projection)));
+				uploadUniform(glUniform2fv, deferred_shader->GetUniformLocation("uv_scale"), 1, glm::value_ptr(uv_scale));
+				m_lights->Bind(*deferred_shader, render_width, render_height);
+				if (shadows) { m_shadow_map->Bind(*deferred_shader, SHADOW_MAP_UNIT, SUN_LIGHT); }
+
+				FrameGraph::Resource inputs[5] = { albedo, normal, specular, emission, depth };
+				for (unsigned int i = 0; i < 5; i++)
+				{
+					glActiveTexture(GL_TEXTURE0 + i);
+					glBindTexture(GL_TEXTURE_2D, graph.getTexture(inputs[i]));
+					render_stats.CountTexture();
+				}
+				renderQuad();
+				glActiveTexture(GL_TEXTURE0);
+			});
+
+			//Skybox and everything that is not lit goes on top, tested against the G-buffer depth
+			m_frame_graph->AddPass("Scene", [&](FrameGraph::Builder& builder)
+			{
+				builder.Read(depth);
+				builder.Write(scene_color);
+				builder.Write(bright);
+				builder.Write(depth);
+			}, [&](FrameGraph& graph)
+			{
+				graph.BindFramebuffer({ scene_color, bright, depth });
+				glViewport(0, 0, render_width, render_height);
+				renderSkybox();
+				renderForward();
+			});
+		}
+		else
+		{
+			m_frame_graph->AddPass("Scene", [&](FrameGraph::Builder& builder)
+			{
+				if (shadows) { builder.Read(shadow_map); }
+				scene_color = builder.Create("Scene Color", hdr_desc);
+				bright = builder.Create("Bright", hdr_desc);
+				depth = builder.Create("Depth Stencil", depth_desc);
+			}, [&](FrameGraph& graph)
+			{
+				graph.BindFramebuffer({ scene_color, bright, depth });
+				glViewport(0, 0, render_width, render_height);
+				glStencilMask(0xFF);
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+				renderScene();
+			});
 		}
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
 
-		//Blurring Frame Buffer
-		glGenFramebuffers(2, pingpongFBO);
-		glGenTextures(2, pingpongColorBuffers);
+		if (selected_planet)
+		{ //Reads the stencil the opaque pass left behind, so the scene color is drawn to without the depth target attached
+			m_frame_graph->AddPass("Outline", [&](FrameGraph::Builder& builder)
+			{
+				builder.Read(depth);
+				builder.Write(scene_color);
+			}, [&](FrameGraph& graph)
+			{
+				graph.BindFramebuffer({ scene_color });
+				glViewport(0, 0, render_width, render_height);
+				renderOutline(graph.getTexture(depth));
+			});
+		}
 
-		for (unsigned int i = 0; i < 2; i++)
+		//Transparent meshes and particles add into two targets in any order, the composite then blends the result over the scene
+		FrameGraph::Resource accumulation, revealage;
+		m_frame_graph->AddPass("Transparency", [&](FrameGraph::Builder& builder)
+		{
+			accumulation = builder.Create("OIT Accumulation", hdr_desc);
+			revealage = builder.Create("OIT Revealage", { target_width, target_height, GL_R16F });
+			builder.Read(depth);
+			if (shadows) { builder.Read(shadow_map); }
+			builder.Write(scene_color);
+		}, [&](FrameGraph& graph)
+		{ //Depth is attached for testing only, transparent surfaces never write it
+			graph.BindFramebuffer({ accumulation, revealage, scene_color, depth });
+			glViewport(0, 0, render_width, render_height);
+			const float clear_accumulation[4] = { 0.f, 0.f, 0.f, 0.f };
+			const float clear_revealage[4] = { 1.f, 0.f, 0.f, 0.f };
+			glClearBufferfv(GL_COLOR, 0, clear_accumulation);
+			glClearBufferfv(GL_COLOR, 1, clear_revealage);
+			renderTransparent();
+		});
+
+		m_frame_graph->AddPass("Transparency Composite", [&](FrameGraph::Builder& builder)
 		{
-			glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[i]);
-			glBindTexture(GL_TEXTURE_2D, pingpongColorBuffers[i]);
-			glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA16F, screen_width, screen_height, 0, GL_RGBA, GL_FLOAT, NULL);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, pingpongColorBuffers[i], 0);
+			builder.Read(accumulation);
+			builder.Read(revealage);
+			builder.Read(depth);
+			builder.Write(scene_color);
+		}, [&](FrameGraph& graph)
+		{ //Depth is attached for the sorted particles, the full screen quads ignore it
+			graph.BindFramebuffer({ scene_color, depth });
+			glViewport(0, 0, render_width, render_height);
+			glDisable(GL_DEPTH_TEST);
+			m_oit_composite_shader->Enable();
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, graph.getTexture(accumulation));
+			render_stats.CountTexture();
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, graph.getTexture(revealage));
+			render_stats.CountTexture();
+			glActiveTexture(GL_TEXTURE0);
+			renderQuad();
+			glEnable(GL_DEPTH_TEST);
+
+			renderSortedParticles();
+			renderScreenTextures();
+		});
+
+		//Two-pass Gaussian blur, the first step is its own pass so the bright target can be reused by the rest
+		m_frame_graph->AddPass("Bloom Blur First", [&](FrameGraph::Builder& builder)
+		{
+			builder.Read(bright);
+			blur[1] = builder.Create("Blur Horizontal", hdr_desc);
+		}, [&](FrameGraph& graph)
+		{
+			graph.BindFramebuffer({ blur[1] });
+			m_blur_shader->Enable();
+			uploadUniform(glUniform2fv, m_blur_shader->GetUniformLocation("uv_scale"), 1, glm::value_ptr(uv_scale));
+			uploadUniform(glUniform2fv, m_blur_shader->GetUniformLocation("uv_max"), 1, glm::value_ptr(uv_max));
+			uploadUniform(glUniform1i, m_blur_shader->GetUniformLocation("horizontal"), true);
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, graph.getTexture(bright));
+			render_stats.CountTexture();
+			renderQuad();
+		});
 
-			if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		m_frame_graph->AddPass("Bloom Blur", [&](FrameGraph::Builder& builder)
+		{
+			builder.Read(blur[1]);
+			blur[0] = builder.Create("Blur Vertical", hdr_desc);
+			builder.Write(blur[1]);
+		}, [&](FrameGraph& graph)
+		{
+			bool horizontal = false;
+			unsigned int amount = 10;
+
+			m_blur_shader->Enable();
+			for (unsigned int i = 1; i < amount; i++)
 			{
-				std::cout << "Blur Framebuffer not complete!" << std::endl;
+				graph.BindFramebuffer({ blur[horizontal] });
+				uploadUniform(glUniform1i, m_blur_shader->GetUniformLocation("horizontal"), horizontal);
+				glActiveTexture(GL_TEXTURE0);
+				glBindTexture(GL_TEXTURE_2D, graph.getTexture(blur[!horizontal]));
+				render_stats.CountTexture();
+				renderQuad();
+				horizontal = !horizontal;
 			}
+		});
+
+		//HDR Rendering
+		m_frame_graph->AddPass("HDR Resolve", [&](FrameGraph::Builder& builder)
+		{
+			builder.Read(scene_color);
+			builder.Read(blur[0]);
+			builder.Write(output);
+		}, [&](FrameGraph& graph)
+		{
+			graph.BindFramebuffer({ output });
+			glViewport(0, 0, screen_width, screen_height);
+			glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+			m_hdr_shader->Enable();
+			uploadUniform(glUniform2fv, m_hdr_shader->GetUniformLocation("uv_scale"), 1, glm::value_ptr(uv_scale));
+			uploadUniform(glUniform2fv, m_hdr_shader->GetUniformLocation("uv_max"), 1, glm::value_ptr(uv_max));
+
+			glActiveTexture(GL_TEXTURE0);
+			glBindTexture(GL_TEXTURE_2D, graph.getTexture(scene_color));
+			render_stats.CountTexture();
+			glActiveTexture(GL_TEXTURE1);
+			glBindTexture(GL_TEXTURE_2D, graph.getTexture(blur[0]));
+			render_stats.CountTexture();
+			renderQuad();
+		});
+
+		if (show_stats)
+		{
+			m_frame_graph->AddPass("Stats Overlay", [&](FrameGraph::Builder& builder)
+			{
+				builder.Write(output);
+			}, [&](FrameGraph& graph)
+			{
+				m_stats_overlay->Render(*m_texture_shader, screen_width, screen_height);
+			});
 		}
 
-		//Shader Settings
-		m_shader->Enable();
-		setShaderLights(m_shader);
+		m_frame_graph->Execute();
 
-		m_blur_shader->Enable();
-		glUniform1i(m_blur_shader->GetUniformLocation("image"), 0);
+#ifdef _DEBUG
+		//Synchronous fallback for drivers without debug output, it can stall the pipeline so release builds leave it out
+		if (!debug_output.isEnabled())
+		{
+			auto error = glGetError();
+			if (error != GL_NO_ERROR)
+			{
+				std::string val = ErrorString(error);
+				std::cout << "Error Initializing OpenGL!" << error << "," << val << std::endl;
+			}
+		}
+#endif
+	}
+
+	void updateRenderScale()
+	{ //Pixel cost grows with the square of the scale, so the step follows the square root of the budget ratio
+		render_scale = dynamic_resolution ? render_scale : 1.f;
+		unsigned long long gpu_sample = profiler.getGpuSampleCount("Render");
+		double gpu_ms = profiler.getLatestGpuTime("Render");
+		if (dynamic_resolution && gpu_sample != render_gpu_sample && gpu_ms > 0.0)
+		{ //Query results stay the latest for several frames, each one is only acted on once
+			render_gpu_sample = gpu_sample;
+			float ratio = gpu_budget_ms / (float)gpu_ms;
+			if (ratio < 0.95f || ratio > 1.05f)
+			{
+				render_scale = glm::clamp(render_scale * lerp(1.f, sqrt(ratio), RENDER_SCALE_GAIN), MIN_RENDER_SCALE, max_render_scale);
+			}
+		}
 
-		m_hdr_shader->Enable();
-		glUniform1i(m_hdr_shader->GetUniformLocation("scene"), 0);
-		glUniform1i(m_hdr_shader->GetUniformLocation("bloomBlur"), 1);
+		float target_scale = dynamic_resolution ? max_render_scale : 1.f; //Screen sized targets when the scale is fixed
+		int width = (int)ceil(screen_width * target_scale);
+		int height = (int)ceil(screen_height * target_scale);
+		if (width != target_width || height != target_height)
+		{ //Pooled targets of the old size would never be reused
+			m_frame_graph->Release();
+			target_width = width;
+			target_height = height;
+		}
+		render_width = std::max(1, (int)(screen_width * render_scale));
+		render_height = std::max(1, (int)(screen_height * render_scale));
+	}
 
+	//Whether a sphere given in view space reaches into the view, tested against the camera plane and the side planes
+	bool sphereInView(const glm::vec3& center, float radius)
+	{
+		glm::mat4 projection = m_camera->GetProjection();
+		float depth = -center.z;
+		if (depth < -radius) { return false; }
+
+		for (int axis = 0; axis < 2; axis++)
+		{ //Distance past the side planes of the frustum
+			float scale = projection[axis][axis];
+			if (std::abs(center[axis]) * scale - depth > radius * sqrt(scale * scale + 1.f)) { return false; }
+		}
 		return true;
 	}
 
-	void Render()
+	//Projected diameter of a model's bounding sphere in render pixels, 0 when it is outside the view
+	float screenSize(Model* model)
 	{
-		glClearColor(0.17, 0.12, 0.19, 1.0); //background color
+		glm::vec3 center = glm::vec3(m_camera->GetRenderView() * glm::vec4(model->getRenderPosition(), 1.f));
+		float radius = model->getRenderBoundingRadius();
+		if (!sphereInView(center, radius)) { return 0.f; }
+		return radius * m_camera->GetProjection()[1][1] * render_height / std::max(-center.z, radius);
+	}
 
-		glBindFramebuffer(GL_FRAMEBUFFER, hdrFBO);
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
+	//Belt chunks the camera sees, shadow passes still draw every instance since casters outside the view throw shadows into it
+	void cullAsteroids()
+	{
+		profiler.BeginMarker("Asteroid Culling", false);
+		glm::mat4 view = m_camera->GetRenderView();
+		auto visible = [this, &view](const glm::vec3& center, float radius) { return sphereInView(glm::vec3(view * glm::vec4(center, 1.f)), radius); };
+		cullAsteroidChunks(belt1_chunks, render_time, m_asteroid_belt1->getRenderBoundingRadius(), visible, belt1_visible);
+		cullAsteroidChunks(belt2_chunks, render_time, m_asteroid_belt2->getRenderBoundingRadius(), visible, belt2_visible);
+		profiler.EndMarker();
+	}
 
+	void streamTextures()
+	{
+		ProfileScope streaming_scope("Texture Streaming", false);
+		std::vector<Model*> models = { m_spaceship, m_player_ship, m_comet, m_sun, m_earth, m_moon, m_jupiter, m_j_moon,
+			m_point_light0, m_point_light1, m_point_light2, m_point_light3 };
+		for (Model* model : models)
+		{
+			model->setScreenSize(screenSize(model));
+		}
+		m_asteroid_belt1->setScreenSize(ASTEROID_SCREEN_SIZE * render_height);
+		m_asteroid_belt2->setScreenSize(ASTEROID_SCREEN_SIZE * render_height);
+		texture_streamer.Update();
+	}
+
+	void clusterLights()
+	{
+		profiler.BeginMarker("Light Clustering", false);
+		m_lights->setPosition(0, m_point_light0->getRenderPosition());
+		m_lights->setPosition(1, m_point_light1->getRenderPosition());
+		m_lights->setPosition(2, m_point_light2->getRenderPosition());
+		m_lights->setPosition(3, m_point_light3->getRenderPosition());
+		m_lights->Bin(m_camera->GetRenderView(), m_camera->GetProjection());
+		m_lights->Upload();
+		profiler.EndMarker();
+	}
+
+	void renderScene()
+	{ //Forward path, every fragment that passes the depth test runs the full lighting shader
+		if (depth_prepass) { renderDepthPrepass(); }
+
+		renderOpaque(m_scene_variants, shadows ? shadowFeatures() : 0, [this](Shader& shader, unsigned int features)
+		{
+			setForwardLighting(shader, features);
+		});
+
+		//After the opaque models, so early depth testing rejects the sky behind them
+		renderSkybox();
+		renderForward();
+	}
+
+	//Per pass uniforms of the lit forward variants
+	void setForwardLighting(Shader& shader, unsigned int features)
+	{
+		uploadUniform(glUniform3fv, shader.GetUniformLocation("view_pos"), 1, glm::value_ptr(m_camera->getRenderPosition()));
+		m_lights->Bind(shader, render_width, render_height);
+		if (features & ShaderVariants::SHADOWS) { m_shadow_map->Bind(shader, SHADOW_MAP_UNIT, SUN_LIGHT); }
+	}
+
+	void renderShadowMap()
+	{
+		m_shadow_map->setLightPosition(m_point_light3->getRenderPosition());
+		m_shadow_variants->Begin([this](Shader& shader, unsigned int features)
+		{
+			uploadUniform(glUniform3fv, shader.GetUniformLocation("light_position"), 1, glm::value_ptr(m_shadow_map->getLightPosition()));
+			uploadUniform(glUniform1f, shader.GetUniformLocation("far_plane"), m_shadow_map->getFarPlane());
+			uploadUniform(glUniformMatrix4fv, shader.GetUniformLocation("viewMatrix"), 1, GL_FALSE, glm::value_ptr(glm::mat4(1.f))); //Face matrices carry the view
+			if (features & ShaderVariants::INSTANCED) { uploadUniform(glUniform1f, shader.GetUniformLocation("time"), render_time); }
+		});
+
+		//Asteroid belts drift slowly and cost the most to draw, so the cache only redraws a face of them per frame
+		profiler.BeginMarker("Shadow Cache");
+		Shader* shadow_shader = m_shadow_variants->Use(ShaderVariants::INSTANCED);
+		for (unsigned int face : m_shadow_map->getStaleFaces())
+		{
+			m_shadow_map->BindFace(ShadowMap::CACHED, face);
+			uploadUniform(glUniformMatrix4fv, shadow_shader->GetUniformLocation("projectionMatrix"), 1, GL_FALSE, glm::value_ptr(m_shadow_map->getFaceMatrix(face)));
+			m_asteroid_belt1->RenderDepth();
+			m_asteroid_belt2->RenderDepth();
+		}
+		m_shadow_map->CopyCache();
+		profiler.EndMarker();
+
+		//Ships, the comet and the orbiting planets go on top every frame, each face only draws the casters inside it
+		profiler.BeginMarker("Shadow Casters");
+		shadow_shader = m_shadow_variants->Use(0);
+		Model* casters[] = { m_spaceship, visiting ? NULL : m_player_ship, m_earth, m_moon, m_jupiter, m_j_moon, m_comet }; //The sun holds the light, it cannot cast
+		for (unsigned int face = 0; face < ShadowMap::FACES; face++)
+		{
+			bool bound = false;
+			for (Model* caster : casters)
+			{
+				if (!caster || !m_shadow_map->isVisible(face, caster->getRenderPosition(), caster->getRenderBoundingRadius())) { continue; }
+				if (!bound)
+				{
+					m_shadow_map->BindFace(ShadowMap::DYNAMIC, face);
+					uploadUniform(glUniformMatrix4fv, shadow_shader->GetUniformLocation("projectionMatrix"), 1, GL_FALSE, glm::value_ptr(m_shadow_map->getFaceMatrix(face)));
+					bound = true;
+				}
+				uploadUniform(glUniformMatrix4fv, shadow_shader->GetUniformLocation("modelMatrix"), 1, GL_FALSE, glm::value_ptr(caster->getRenderModel()));
+				caster->RenderDepth();
+			}
+		}
+		profiler.EndMarker();
+	}
+
+	void renderDepthPrepass()
+	{
+		profiler.BeginMarker("Depth Pre-Pass");
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+		m_depth_variants->Begin([this](Shader& shader, unsigned int features)
+		{
+			uploadUniform(glUniformMatrix4fv, shader.GetUniformLocation("projectionMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetProjection()));
+			uploadUniform(glUniformMatrix4fv, shader.GetUniformLocation("viewMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetRenderView()));
+			if (features & ShaderVariants::INSTANCED) { uploadUniform(glUniform1f, shader.GetUniformLocation("time"), render_time); }
+		});
+
+		//Same models as renderOpaque, anything missing here would fail the equal test and disappear
+		Shader* depth_shader = m_depth_variants->Use(0);
+		Model* models[] = { m_spaceship, visiting ? NULL : m_player_ship, m_sun, m_earth, m_moon, m_jupiter, m_j_moon, m_comet };
+		for (Model* model : models)
+		{
+			if (!model) { continue; }
+			uploadUniform(glUniformMatrix4fv, depth_shader->GetUniformLocation("modelMatrix"), 1, GL_FALSE, glm::value_ptr(model->getRenderModel()));
+			model->RenderDepth();
+		}
+
+		m_depth_variants->Use(ShaderVariants::INSTANCED);
+		m_asteroid_belt1->RenderDepth(&belt1_visible);
+		m_asteroid_belt2->RenderDepth(&belt2_visible);
+
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		profiler.EndMarker();
+	}
+
+	void renderSkybox()
+	{
 		//-------------------- Render Cube Map
+		profiler.BeginMarker("Skybox");
 		glDepthFunc(GL_LEQUAL);
 		m_skybox_shader->Enable();
-		glUniformMatrix4fv(m_skybox_shader->GetUniformLocation("projectionMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetProjection()));
-		glUniformMatrix4fv(m_skybox_shader->GetUniformLocation("viewMatrix"), 1, GL_FALSE, glm::value_ptr(glm::mat4(glm::mat3(m_camera->GetView()))));
+		uploadUniform(glUniformMatrix4fv, m_skybox_shader->GetUniformLocation("projectionMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetProjection()));
+		uploadUniform(glUniformMatrix4fv, m_skybox_shader->GetUniformLocation("viewMatrix"), 1, GL_FALSE, glm::value_ptr(glm::mat4(glm::mat3(m_camera->GetRenderView()))));
 		m_skybox->Render();
 		glDepthFunc(GL_LESS);
+		profiler.EndMarker();
+	}
 
+	//Planets, ships and asteroids, drawn with the lit forward variants or the G-buffer variants. Each mesh picks the variant for
+	//features plus what its material has, pass_setup sets the uniforms that stay the same for the whole pass.
+	void renderOpaque(ShaderVariants* variants, unsigned int features, ShaderVariants::Setup pass_setup)
+	{
 		//-------------------- Render Models
+		profiler.BeginMarker("Opaque Models");
 		glStencilMask(0xFF);
 		glStencilFunc(GL_ALWAYS, 1, 0xFF);
+		if (depth_prepass)
+		{ //Depth is already final, only the front most fragment of each pixel passes
+			glDepthFunc(GL_EQUAL);
+			glDepthMask(GL_FALSE);
+		}
 
-		m_shader->Enable();
-		glUniform3fv(m_shader->GetUniformLocation("view_pos"), 1, glm::value_ptr(m_camera->getPosition()));
-		glUniform1f(m_shader->GetUniformLocation("material.alpha"), 1.0);
-		glUniform3fv(m_shader->GetUniformLocation("point_lights[0].position"), 1, glm::value_ptr(m_point_light0->getPosition()));
-		glUniform3fv(m_shader->GetUniformLocation("point_lights[1].position"), 1, glm::value_ptr(m_point_light1->getPosition()));
-		glUniform3fv(m_shader->GetUniformLocation("point_lights[2].position"), 1, glm::value_ptr(m_point_light2->getPosition()));
-		glUniform3fv(m_shader->GetUniformLocation("point_lights[3].position"), 1, glm::value_ptr(m_point_light3->getPosition()));
-
-		glUniformMatrix4fv(m_shader->GetUniformLocation("projectionMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetProjection()));
-		glUniformMatrix4fv(m_shader->GetUniformLocation("viewMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetView()));
+		beginModels(variants, pass_setup);
+		renderModels(variants, features);
+		glStencilMask(0x00);
+		profiler.EndMarker();
+
+		profiler.BeginMarker("Asteroid Instancing");
+		renderAsteroids(variants, features);
+		profiler.EndMarker();
+
+		if (vertex_probe)
+		{ //Every instance, so the time matches the vertex count. The second draw inverts per vertex as the shader did before normal matrices were supplied.
+			glEnable(GL_RASTERIZER_DISCARD);
+			profiler.BeginMarker("Asteroid Vertices");
+			renderAsteroids(variants, features, false);
+			profiler.EndMarker();
+			profiler.BeginMarker("Asteroid Vertices Inverse");
+			renderAsteroids(variants, features | ShaderVariants::NORMAL_INVERSE, false);
+			profiler.EndMarker();
+			glDisable(GL_RASTERIZER_DISCARD);
+		}
 
-		//Ships
-		glUniform1f(m_shader->GetUniformLocation("material.shininess"), 50.f);
-		glUniformMatrix4fv(m_shader->GetUniformLocation("modelMatrix"), 1, GL_FALSE, glm::value_ptr(m_spaceship->getModel()));
-		m_spaceship->Render(*m_shader);
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+	}
 
-		if (!visiting)
+	//Starts a pass over the models, pass_setup adds its own uniforms to the camera ones
+	void beginModels(ShaderVariants* variants, ShaderVariants::Setup pass_setup)
+	{
+		variants->Begin([this, pass_setup](Shader& shader, unsigned int variant_features)
 		{
-			glUniform1f(m_shader->GetUniformLocation("material.shininess"), 20.f);
-			glUniformMatrix4fv(m_shader->GetUniformLocation("modelMatrix"), 1, GL_FALSE, glm::value_ptr(m_player_ship->getModel()));
-			m_player_ship->Render(*m_shader);
-		}
+			uploadUniform(glUniformMatrix4fv, shader.GetUniformLocation("projectionMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetProjection()));
+			uploadUniform(glUniformMatrix4fv, shader.GetUniformLocation("viewMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetRenderView()));
+			if (variant_features & ShaderVariants::INSTANCED) { uploadUniform(glUniform1f, shader.GetUniformLocation("time"), render_time); }
+			if (pass_setup) { pass_setup(shader, variant_features); }
+		});
+	}
+
+	//Ships and planets. With TRANSPARENT in features only their see-through meshes are drawn.
+	void renderModels(ShaderVariants* variants, unsigned int features)
+	{
+		//Ships
+		renderModel(variants, m_spaceship, features, 50.f);
+		if (!visiting) { renderModel(variants, m_player_ship, features, 20.f); }
 
 		//Planets
-		glUniform1f(m_shader->GetUniformLocation("emissive"), true);
-		glUniform1f(m_shader->GetUniformLocation("material.shininess"), 30.f);
-		glUniformMatrix4fv(m_shader->GetUniformLocation("modelMatrix"), 1, GL_FALSE, glm::value_ptr(m_sun->getModel()));
-		m_sun->Render(*m_shader);
-
-		glUniform1f(m_shader->GetUniformLocation("material.shininess"), 5.f);
-		glUniformMatrix4fv(m_shader->GetUniformLocation("modelMatrix"), 1, GL_FALSE, glm::value_ptr(m_earth->getModel()));
-		m_earth->Render(*m_shader);
-		glUniform1f(m_shader->GetUniformLocation("emissive"), false);
-
-		glUniform1f(m_shader->GetUniformLocation("material.shininess"), 15.f);
-		glUniformMatrix4fv(m_shader->GetUniformLocation("modelMatrix"), 1, GL_FALSE, glm::value_ptr(m_moon->getModel()));
-		m_moon->Render(*m_shader);
-
-		glUniform1f(m_shader->GetUniformLocation("material.shininess"), 5.f);
-		glUniformMatrix4fv(m_shader->GetUniformLocation("modelMatrix"), 1, GL_FALSE, glm::value_ptr(m_jupiter->getModel()));
-		m_jupiter->Render(*m_shader);
-
-		glUniform1f(m_shader->GetUniformLocation("material.shininess"), 15.f);
-		glUniformMatrix4fv(m_shader->GetUniformLocation("modelMatrix"), 1, GL_FALSE, glm::value_ptr(m_j_moon->getModel()));
-		m_j_moon->Render(*m_shader);
-
-		glUniform1f(m_shader->GetUniformLocation("emissive"), true);
-		glUniform1f(m_shader->GetUniformLocation("material.shininess"), 45.f);
-		glUniformMatrix4fv(m_shader->GetUniformLocation("modelMatrix"), 1, GL_FALSE, glm::value_ptr(m_comet->getModel()));
-		m_comet->Render(*m_shader);
-		glUniform1f(m_shader->GetUniformLocation("emissive"), false);
+		stencilModel(m_sun);
+		renderModel(variants, m_sun, features | ShaderVariants::EMISSIVE, 30.f);
+		stencilModel(m_earth);
+		renderModel(variants, m_earth, features | ShaderVariants::EMISSIVE, 5.f);
+		stencilModel(m_moon);
+		renderModel(variants, m_moon, features, 15.f);
+		stencilModel(m_jupiter);
+		renderModel(variants, m_jupiter, features, 5.f);
+		stencilModel(m_j_moon);
+		renderModel(variants, m_j_moon, features, 15.f);
+		stencilModel(m_comet);
+		renderModel(variants, m_comet, features | ShaderVariants::EMISSIVE, 45.f);
+	}
 
-		glStencilMask(0x00);
+	//Instancing, the belt meshes select the instanced variants themselves
+	void renderAsteroids(ShaderVariants* variants, unsigned int features, bool culled = true)
+	{
+		renderModel(variants, m_asteroid_belt1, features, 45.f, culled ? &belt1_visible : NULL);
+		renderModel(variants, m_asteroid_belt2, features, 45.f, culled ? &belt2_visible : NULL);
+	}
 
-		//Instancing
-		glUniform1i(m_shader->GetUniformLocation("use_instancing"), true);
-		glUniform1f(m_shader->GetUniformLocation("material.shininess"), 45.f);
-		m_asteroid_belt1->Render(*m_shader);
-		m_asteroid_belt2->Render(*m_shader);
-		glUniform1i(m_shader->GetUniformLocation("use_instancing"), false);
+	//Per draw uniforms go to every variant the model's meshes switch to
+	void renderModel(ShaderVariants* variants, Model* model, unsigned int features, float shininess, const std::vector<Instance_Range>* ranges = NULL)
+	{
+		glm::mat4 model_matrix = model->getRenderModel();
+		glm::mat3 normal_matrix = model->getRenderNormalMatrix();
+		model->Render(*variants, features, [&](Shader& shader, unsigned int mesh_features)
+		{
+			uploadUniform(glUniform1f, shader.GetUniformLocation("material.shininess"), shininess);
+			if (!(mesh_features & ShaderVariants::INSTANCED))
+			{
+				uploadUniform(glUniformMatrix4fv, shader.GetUniformLocation("modelMatrix"), 1, GL_FALSE, glm::value_ptr(model_matrix));
+				uploadUniform(glUniformMatrix3fv, shader.GetUniformLocation("normalMatrix"), 1, GL_FALSE, glm::value_ptr(normal_matrix));
+			}
+		}, ranges);
+	}
 
-		
+	//Lights, which are never deferred
+	void renderForward()
+	{
 		//-------------------- Render Lights
+		profiler.BeginMarker("Lights");
 		m_light_shader->Enable();
-		glUniformMatrix4fv(m_light_shader->GetUniformLocation("projectionMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetProjection()));
-		glUniformMatrix4fv(m_light_shader->GetUniformLocation("viewMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetView()));
-		glUniformMatrix4fv(m_light_shader->GetUniformLocation("modelMatrix"), 1, GL_FALSE, glm::value_ptr(m_point_light3->getModel()));
+		uploadUniform(glUniformMatrix4fv, m_light_shader->GetUniformLocation("projectionMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetProjection()));
+		uploadUniform(glUniformMatrix4fv, m_light_shader->GetUniformLocation("viewMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetRenderView()));
+		uploadUniform(glUniformMatrix4fv, m_light_shader->GetUniformLocation("modelMatrix"), 1, GL_FALSE, glm::value_ptr(m_point_light3->getRenderModel()));
 		m_point_light3->Render(*m_light_shader);
+		profiler.EndMarker();
+	}
 
-		//-------------------- Render Outlines
-		can_visit = closest_planet.second <= SELECT_PLANET_RANGE;
-		if (can_visit && !visiting)
-		{
-			if (closest_planet.first == "sun") { drawOutline(m_sun); }
-			else if (closest_planet.first == "earth") { drawOutline(m_earth); }
-			else if (closest_planet.first == "moon") { drawOutline(m_moon); }
-			else if (closest_planet.first == "jupiter") { drawOutline(m_jupiter); }
-			else if (closest_planet.first == "j_moon") { drawOutline(m_j_moon); }
-		}
+	//Transparent meshes and particles, accumulated into the weighted blended targets in any order. Depth is tested against
+	//the opaque scene but never written, and the stencil is left alone.
+	void renderTransparent()
+	{
+		glDepthMask(GL_FALSE);
+		glStencilMask(0x00);
+		glBlendFunci(0, GL_ONE, GL_ONE); //Accumulation
+		glBlendFunci(1, GL_ZERO, GL_ONE_MINUS_SRC_COLOR); //Revealage, each layer multiplies in what it lets through
+		glBlendFunci(2, GL_ONE, GL_ONE); //Additive light, straight into the scene color
+
+		//Meshes whose material has an opacity below 1, none of the opaque passes draw them
+		profiler.BeginMarker("Transparent Models");
+		unsigned int features = ShaderVariants::TRANSPARENT | (shadows ? shadowFeatures() : 0);
+		beginModels(m_scene_variants, [this](Shader& shader, unsigned int variant_features) { setForwardLighting(shader, variant_features); });
+		renderModels(m_scene_variants, features);
+		renderAsteroids(m_scene_variants, features);
+		profiler.EndMarker();
 
 		//-------------------- Render Particles
+		profiler.BeginMarker("Particles");
 		m_particle_shader->Enable();
-		glUniformMatrix4fv(m_particle_shader->GetUniformLocation("viewMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetView()));
-		glUniformMatrix4fv(m_particle_shader->GetUniformLocation("projectionMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetProjection()));
+		uploadUniform(glUniformMatrix4fv, m_particle_shader->GetUniformLocation("viewMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetRenderView()));
+		uploadUniform(glUniformMatrix4fv, m_particle_shader->GetUniformLocation("projectionMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetProjection()));
 
 		if (!visiting)
 		{
-			glUniform1f(m_particle_shader->GetUniformLocation("scale"), .08f);
+			uploadUniform(glUniform1f, m_particle_shader->GetUniformLocation("scale"), .08f);
 			m_engine_particle1->Render(*m_particle_shader);
 			m_engine_particle2->Render(*m_particle_shader);
 		}
 
-		glUniform1f(m_particle_shader->GetUniformLocation("scale"), 1.5f);
+		uploadUniform(glUniform1f, m_particle_shader->GetUniformLocation("scale"), 1.5f);
 		m_sun_particle->Render(*m_particle_shader);
 
-		glUniform1f(m_particle_shader->GetUniformLocation("scale"), .75f);
-		m_ship_particle->Render(*m_particle_shader);
-
-		glUniform1f(m_particle_shader->GetUniformLocation("scale"), .8f);
+		uploadUniform(glUniform1f, m_particle_shader->GetUniformLocation("scale"), .8f);
 		m_comet_particle->Render(*m_particle_shader);
+		profiler.EndMarker();
+
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+		glDepthMask(GL_TRUE);
+	}
+
+	//Sorts the SORTED emitters back to front on a worker, renderSortedParticles waits for it. Started before the opaque
+	//passes are recorded so the sort overlaps them, the particles were already moved by Update.
+	void startParticleSort()
+	{
+		m_jobs->BeginFrame();
+		glm::mat4 view = m_camera->GetRenderView();
+		particle_sort = m_jobs->CreateJob([this, view]()
+		{
+			std::vector<Emitter*> emitters = { m_engine_particle1, m_engine_particle2, m_sun_particle, m_ship_particle, m_comet_particle };
+			for (Emitter* emitter : emitters)
+			{
+				if (emitter->getBlending() == Emitter::SORTED) { emitter->SortParticles(view); }
+			}
+		});
+		m_jobs->Submit(particle_sort);
+	}
+
+	//Particles that need true alpha blending, drawn far to near over the composited scene. Depth is tested, not written.
+	//Only opaque surfaces write depth, so these particles always draw over transparent meshes and weighted or additive
+	//particles, even the ones in front of them. Fine for the ship's trail, which rarely passes behind anything see-through.
+	void renderSortedParticles()
+	{
+		{
+			ProfileScope wait_scope("Particle Sort Wait", false);
+			m_jobs->Wait(particle_sort);
+		}
+
+		profiler.BeginMarker("Sorted Particles");
+		glDepthMask(GL_FALSE);
+		glStencilMask(0x00);
+		m_sorted_particle_shader->Enable();
+		uploadUniform(glUniformMatrix4fv, m_sorted_particle_shader->GetUniformLocation("viewMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetRenderView()));
+		uploadUniform(glUniformMatrix4fv, m_sorted_particle_shader->GetUniformLocation("projectionMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetProjection()));
+
+		uploadUniform(glUniform1f, m_sorted_particle_shader->GetUniformLocation("scale"), .75f);
+		m_ship_particle->Render(*m_sorted_particle_shader);
+
+		glDepthMask(GL_TRUE);
+		profiler.EndMarker();
+	}
 
-		//Screen Textures
+	//Drawn over the finished scene
+	void renderScreenTextures()
+	{
 		if (visiting)
 		{
+			profiler.BeginMarker("Screen Textures");
 			m_texture_shader->Enable();
 			m_console_texture->bindTextures();
 			renderQuad();
+			profiler.EndMarker();
 		}
+	}
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-
-		//Two-pass Gaussian blur
-		bool horizontal = true;
-		bool first_iteration = true;
-		unsigned int amount = 10;
-
-		m_blur_shader->Enable();
-		for (unsigned int i = 0; i < amount; i++)
+	void selectPlanet()
+	{ //The closest planet in range can be visited, it is outlined until then
+		can_visit = closest_planet.second <= SELECT_PLANET_RANGE;
+		selected_planet = NULL;
+		if (can_visit && !visiting)
 		{
-			glBindFramebuffer(GL_FRAMEBUFFER, pingpongFBO[horizontal]);
-			glUniform1i(m_blur_shader->GetUniformLocation("horizontal"), horizontal);
-			glActiveTexture(GL_TEXTURE0);
-			glBindTexture(GL_TEXTURE_2D, first_iteration ? colorBuffers[1] : pingpongColorBuffers[!horizontal]);
-			renderQuad();
-			horizontal = !horizontal;
-			if (first_iteration) { first_iteration = false; }
+			if (closest_planet.first == "sun") { selected_planet = m_sun; }
+			else if (closest_planet.first == "earth") { selected_planet = m_earth; }
+			else if (closest_planet.first == "moon") { selected_planet = m_moon; }
+			else if (closest_planet.first == "jupiter") { selected_planet = m_jupiter; }
+			else if (closest_planet.first == "j_moon") { selected_planet = m_j_moon; }
 		}
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
 
-		//HDR Rendering
-		glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT | GL_STENCIL_BUFFER_BIT);
-		m_hdr_shader->Enable();
+	//Stencil value for a model drawn by renderOpaque
+	void stencilModel(Model* model)
+	{
+		glStencilFunc(GL_ALWAYS, model == selected_planet ? OUTLINE_STENCIL : 1, 0xFF);
+	}
 
-		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, colorBuffers[0]);
-		glActiveTexture(GL_TEXTURE1);
-		glBindTexture(GL_TEXTURE_2D, pingpongColorBuffers[!horizontal]);
-		renderQuad();
+	//Render viewport rectangle covered by a model's bounding sphere, false when the sphere reaches behind the camera
+	bool screenBounds(Model* model, int border, int bounds[4])
+	{
+		glm::mat4 view_projection = m_camera->GetProjection() * m_camera->GetRenderView();
+		glm::vec3 center = model->getRenderPosition();
+		float radius = model->getRenderBoundingRadius();
+		float low[2] = { FLT_MAX, FLT_MAX }, high[2] = { -FLT_MAX, -FLT_MAX };
+		for (unsigned int corner = 0; corner < 8; corner++)
+		{
+			glm::vec3 offset((corner & 1) ? radius : -radius, (corner & 2) ? radius : -radius, (corner & 4) ? radius : -radius);
+			glm::vec4 clip = view_projection * glm::vec4(center + offset, 1.f);
+			if (clip.w <= 0.f) { return false; }
+			for (int axis = 0; axis < 2; axis++)
+			{
+				low[axis] = std::min(low[axis], clip[axis] / clip.w);
+				high[axis] = std::max(high[axis], clip[axis] / clip.w);
+			}
+		}
 
-		auto error = glGetError();
-		if (error != GL_NO_ERROR)
+		int size[2] = { render_width, render_height };
+		for (int axis = 0; axis < 2; axis++)
 		{
-			std::string val = ErrorString(error);
-			std::cout << "Error Initializing OpenGL!" << error << "," << val << std::endl;
+			bounds[axis] = glm::clamp((int)floor((low[axis] * 0.5f + 0.5f) * size[axis]) - border, 0, size[axis]);
+			bounds[axis + 2] = glm::clamp((int)ceil((high[axis] * 0.5f + 0.5f) * size[axis]) + border, 0, size[axis]) - bounds[axis];
 		}
+		return true;
 	}
 
-	void drawOutline(Model* model)
+	void renderOutline(unsigned int depth_stencil)
 	{
-		glStencilFunc(GL_NOTEQUAL, 1, 0xFF);
+		int outline_width = std::max(1, (int)round(OUTLINE_WIDTH * render_scale));
+
+		//Only the pixels around the selected planet need the neighbourhood search
+		int bounds[4];
+		if (screenBounds(selected_planet, outline_width, bounds))
+		{
+			if (bounds[2] <= 0 || bounds[3] <= 0) { return; }
+			glEnable(GL_SCISSOR_TEST);
+			glScissor(bounds[0], bounds[1], bounds[2], bounds[3]);
+		}
+
 		glDisable(GL_DEPTH_TEST);
+		glDisable(GL_STENCIL_TEST);
 
 		m_outline_shader->Enable();
-		glUniform1f(m_outline_shader->GetUniformLocation("outline"), 1.01f);
-		glUniformMatrix4fv(m_outline_shader->GetUniformLocation("projectionMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetProjection()));
-		glUniformMatrix4fv(m_outline_shader->GetUniformLocation("viewMatrix"), 1, GL_FALSE, glm::value_ptr(m_camera->GetView()));
-		glUniformMatrix4fv(m_outline_shader->GetUniformLocation("modelMatrix"), 1, GL_FALSE, glm::value_ptr(model->getModel()));
-		model->RenderOutline();
+		uploadUniform(glUniform1i, m_outline_shader->GetUniformLocation("stencil_mask"), 0);
+		uploadUniform(glUniform1ui, m_outline_shader->GetUniformLocation("selected_stencil"), OUTLINE_STENCIL);
+		uploadUniform(glUniform1i, m_outline_shader->GetUniformLocation("outline_width"), outline_width);
 
-		glStencilMask(0xFF);
-		glStencilFunc(GL_ALWAYS, 0, 0xFF);
+		//The depth stencil target is read as stencil indices here, and as depth everywhere else
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, depth_stencil);
+		glTexParameteri(GL_TEXTURE_2D, GL_DEPTH_STENCIL_TEXTURE_MODE, GL_STENCIL_INDEX);
+		render_stats.CountTexture();
+		renderQuad();
+		glTexParameteri(GL_TEXTURE_2D, GL_DEPTH_STENCIL_TEXTURE_MODE, GL_DEPTH_COMPONENT);
+
+		glEnable(GL_STENCIL_TEST);
 		glEnable(GL_DEPTH_TEST);
+		glDisable(GL_SCISSOR_TEST);
 	}
 
 	std::string ErrorString(GLenum error)
@@ -714,6 +1386,7 @@ public:
 			temp_camera_pos = m_camera->getPosition();
 			temp_camera_rot = m_camera->getRotation();
 			visiting = true;
+			m_camera->ResetInterpolation();
 			//std::cout << "Entered the planet: " << closest_planet.first << std::endl;
 		}
 		else if (visiting)
@@ -721,10 +1394,152 @@ public:
 			m_camera->setPosition(temp_camera_pos);
 			m_camera->setRotation(temp_camera_rot);
 			visiting = false;
+			m_camera->ResetInterpolation();
 			//std::cout << "Leaving the planet: " << closest_planet.first << std::endl;
 		}
 	}
 
+	void visitPlanet(const std::string& planet)
+	{ //Visits a planet by name regardless of distance, used by scripted camera paths.
+		if (visiting) { return; }
+		closest_planet = std::make_pair(planet, 0.f);
+		can_visit = true;
+		visitPlanet();
+	}
+
+	bool isVisiting()
+	{
+		return visiting;
+	}
+
+	void setCameraPose(glm::vec3 position, glm::vec3 target)
+	{
+		m_camera->setPosition(position);
+		m_camera->setRotation(glm::normalize(target - position));
+	}
+
+	void setDynamicResolution(bool enabled, float budget_ms)
+	{
+		dynamic_resolution = enabled;
+		gpu_budget_ms = budget_ms;
+	}
+
+	void setSupersampling(bool enabled)
+	{ //Lets dynamic resolution go above 1 when under budget, at the cost of larger scene targets
+		max_render_scale = enabled ? SUPERSAMPLE_SCALE : 1.f;
+		render_scale = std::min(render_scale, max_render_scale);
+	}
+
+	void toggleDynamicResolution()
+	{
+		dynamic_resolution = !dynamic_resolution;
+		std::cout << "Dynamic resolution " << (dynamic_resolution ? "on" : "off") << std::endl;
+	}
+
+	float getRenderScale()
+	{
+		return render_scale;
+	}
+
+	void setDeferredShading(bool enabled)
+	{
+		deferred_shading = enabled;
+	}
+
+	void setDepthPrepass(bool enabled)
+	{
+		depth_prepass = enabled;
+	}
+
+	void setVertexProbe(bool enabled)
+	{ //Must be set before Initialize
+		vertex_probe = enabled;
+	}
+
+	void toggleDepthPrepass()
+	{
+		depth_prepass = !depth_prepass;
+		std::cout << "Depth pre-pass " << (depth_prepass ? "on" : "off") << std::endl;
+	}
+
+	void toggleDeferredShading()
+	{
+		deferred_shading = !deferred_shading;
+		std::cout << (deferred_shading ? "Deferred" : "Forward") << " shading" << std::endl;
+	}
+
+	void setShadows(bool enabled, ShadowMap::Filter filter)
+	{ //Before Initialize, so the variants for the filter are built with the rest
+		shadows = enabled;
+		shadow_filter = filter;
+	}
+
+	void toggleShadows()
+	{
+		shadows = !shadows;
+		m_shadow_map->InvalidateCache(); //Casters kept moving while it was off
+		std::cout << "Shadows " << (shadows ? "on" : "off") << std::endl;
+	}
+
+	void cycleShadowFilter()
+	{
+		static const char* names[] = { "hard", "medium", "soft" };
+		shadow_filter = (ShadowMap::Filter)((shadow_filter + 1) % ShadowMap::FILTER_COUNT);
+		std::cout << "Shadow filter " << names[shadow_filter] << std::endl; //The first switch to a filter compiles its variants
+	}
+
+	void toggleStatsOverlay()
+	{
+		show_stats = !show_stats;
+	}
+
+	void setShaderCache(bool enabled)
+	{ //Must be set before Initialize
+		use_shader_cache = enabled;
+	}
+
+	void setAsteroidCount(unsigned int count)
+	{ //Must be set before Initialize, each belt keeps at least one instance since the shadow and probe draws always use the instanced path
+		asteroid_count = std::max(count, 3u);
+	}
+
+	void setTextureStreaming(bool enabled)
+	{ //Must be set before Initialize, without streaming every texture is at full detail before the first frame
+		texture_streaming = enabled;
+	}
+
+	void setShaderHotReload(bool enabled)
+	{
+		m_shader_manager->setHotReload(enabled);
+	}
+
+	//Unique vertices of the asteroid belts per draw, every instance counts
+	unsigned long long getAsteroidVertexCount()
+	{
+		return m_asteroid_belt1->getVertexCount() + m_asteroid_belt2->getVertexCount();
+	}
+
+	unsigned long long getAsteroidIndexCount()
+	{
+		return m_asteroid_belt1->getIndexCount() + m_asteroid_belt2->getIndexCount();
+	}
+
+	double getShaderStartupTime()
+	{
+		return m_shader_manager->getBuildTime();
+	}
+
+	bool isShaderCacheWarm()
+	{
+		return m_shader_manager->isCacheWarm();
+	}
+
+	void setSeed(unsigned int seed)
+	{ //Must be set before Initialize
+		use_fixed_seed = true;
+		fixed_seed = seed;
+	}
+
 	void setZoomDistance(float zoom)
 	{
 		zoom_distance = zoom;
@@ -773,17 +1588,23 @@ public:
 		m_camera->setRotation(glm::normalize(model->getPosition() - current_visit_pos));
 	}
 
-	void computeTransforms(double dt, std::vector<float> speed, std::vector<float> dist, std::vector<float> rotation_speed, std::vector<float> scale,
-		glm::vec3 rotation_vector, glm::mat4 &tmat, glm::mat4 &rmat, glm::mat4 &smat)
-	{
-		double elapsed_time = glfwGetTime();
-		tmat = glm::translate(glm::mat4(1.f), glm::vec3(cos(speed[0] * elapsed_time) * dist[0], sin(speed[1] * elapsed_time) * dist[1], sin(speed[2] * elapsed_time) * dist[2]));
-		rmat = glm::rotate(glm::mat4(1.f), rotation_speed[0] * (float)elapsed_time, rotation_vector);
-		smat = glm::scale(glm::vec3(scale[0], scale[1], scale[2]));
+	void Interpolate(float alpha)
+	{ //Blends the last two simulation steps for rendering, alpha is how far the frame is into the next step.
+		m_camera->Interpolate(alpha);
+		render_time = (float)(sim_time - (1.0 - alpha) * sim_step);
+
+		std::vector<Model*> models = { m_spaceship, m_player_ship, m_comet, m_sun, m_earth, m_moon, m_jupiter, m_j_moon,
+			m_point_light0, m_point_light1, m_point_light2, m_point_light3 };
+		for (Model* model : models)
+		{
+			model->Interpolate(alpha);
+		}
 	}
 
 	void Update(double dt, float fov)
 	{ //Objects transform should be updated here so different objects can move independently.
+		sim_time += dt;
+		sim_step = dt;
 		m_camera->Update(dt);
 		m_camera->setFOV(fov);
 
@@ -813,83 +1634,108 @@ public:
 			else if (closest_planet.first == "j_moon") { viewPlanet(m_j_moon, 8.f + zoom_distance, dt); }
 		}
 
-		//Player Particles
-		glm::mat4 particle_engine_origin1 = glm::translate(player_mat, glm::vec3(14.3f, -1.6f, -23.3f));
-		glm::mat4 particle_engine_origin2 = glm::translate(player_mat, glm::vec3(-14.3f, -1.6f, -23.3f));
-		glm::vec3 particle_engine_velocity = glm::normalize(glm::vec3(player_mat * glm::vec4(0.f, 0.f, -1.f, 0.f)));
-
-		m_engine_particle1->emitParticles(dt, particle_engine_origin1[3], particle_engine_velocity);
-		m_engine_particle2->emitParticles(dt, particle_engine_origin2[3], particle_engine_velocity);
+		//Everything below only reads the player and camera state computed above, so it runs as a job graph.
+		m_jobs->BeginFrame();
+		JobSystem::Job* frame_done = m_jobs->CreateJob(NULL);
 
-		//Player Lights
-		particle_engine_origin1 = glm::translate(particle_engine_origin1, glm::vec3(.0f, 0.f, -.6f));
-		particle_engine_origin2 = glm::translate(particle_engine_origin2, glm::vec3(.0f, 0.f, -.6f));
+		//Player Particles and Lights
+		JobSystem::Job* engine_particles1 = m_jobs->CreateJob([this, dt]()
+		{
+			glm::mat4 particle_engine_origin = glm::translate(player_mat, glm::vec3(14.3f, -1.6f, -23.3f));
+			glm::vec3 particle_engine_velocity = glm::normalize(glm::vec3(player_mat * glm::vec4(0.f, 0.f, -1.f, 0.f)));
+			m_engine_particle1->emitParticles(dt, particle_engine_origin[3], particle_engine_velocity);
+
+			particle_engine_origin = glm::translate(particle_engine_origin, glm::vec3(.0f, 0.f, -.6f));
+			m_point_light1->Update(particle_engine_origin * glm::scale(glm::vec3(.03f, .03f, .03f)));
+		});
+		JobSystem::Job* engine_particles2 = m_jobs->CreateJob([this, dt]()
+		{
+			glm::mat4 particle_engine_origin = glm::translate(player_mat, glm::vec3(-14.3f, -1.6f, -23.3f));
+			glm::vec3 particle_engine_velocity = glm::normalize(glm::vec3(player_mat * glm::vec4(0.f, 0.f, -1.f, 0.f)));
+			m_engine_particle2->emitParticles(dt, particle_engine_origin[3], particle_engine_velocity);
 
-		m_point_light1->Update(particle_engine_origin1 * glm::scale(glm::vec3(.03f, .03f, .03f)));
-		m_point_light2->Update(particle_engine_origin2 * glm::scale(glm::vec3(.03f, .03f, .03f)));
+			particle_engine_origin = glm::translate(particle_engine_origin, glm::vec3(.0f, 0.f, -.6f));
+			m_point_light2->Update(particle_engine_origin * glm::scale(glm::vec3(.03f, .03f, .03f)));
+		});
 
 		//--------------------Orbital Transforms
-		double elapsed_time = glfwGetTime();
-		glm::vec3 up = glm::vec3(0.f, 1.f, 0.f);
-		
-		//Spaceship
-		float spaceship_radius = 125.f;
-		float spaceship_speed = 0.05f;
-
-		glm::vec3 direction = glm::vec3(cos(spaceship_speed * elapsed_time) * spaceship_radius, 5.f, sin(spaceship_speed * elapsed_time) * spaceship_radius);
-		glm::vec3 tangent = glm::normalize(glm::cross(direction, up));
-		float angle = glm::atan2(tangent.x, tangent.z);
+		double elapsed_time = sim_time;
 
-		glm::mat4 spaceship_tmat = glm::translate(glm::mat4(1.f), direction);
-		glm::mat4 spaceship_rmat = glm::rotate(glm::mat4(1.f), angle, glm::vec3(0.f, 1.f, 0.f));
-		glm::mat4 spaceship_smat = glm::scale(glm::vec3(.25f, .25f, .25f));
-		m_spaceship->Update(spaceship_tmat * spaceship_rmat * spaceship_smat);
-
-		//Ship Particles
-		glm::mat4 particle_ship_origin = glm::translate(spaceship_tmat * spaceship_rmat, glm::vec3(.0f, .0f, -1.f));
-		glm::vec3 particle_ship_velocity = glm::normalize(glm::vec3(spaceship_tmat * spaceship_rmat * glm::vec4(0.f, 0.f, -1.f, 0.f)));
-		m_ship_particle->emitParticles(dt, particle_ship_origin[3], particle_ship_velocity);
-
-		//Ship Lights
-		glm::vec3 light_direction = glm::vec3(cos(spaceship_speed * elapsed_time - .04f) * spaceship_radius, 5.f, sin(spaceship_speed * elapsed_time - .04f) * spaceship_radius); //Light trails behind spaceship
-		glm::mat4 light0_tmat = glm::translate(glm::mat4(1.f), light_direction);
-		m_point_light0->Update(light0_tmat);
+		//Spaceship
+		JobSystem::Job* spaceship = m_jobs->CreateJob([this, elapsed_time]()
+		{
+			glm::vec3 up = glm::vec3(0.f, 1.f, 0.f);
+			float spaceship_radius = 125.f;
+			float spaceship_speed = 0.05f;
+
+			glm::vec3 direction = glm::vec3(cos(spaceship_speed * elapsed_time) * spaceship_radius, 5.f, sin(spaceship_speed * elapsed_time) * spaceship_radius);
+			glm::vec3 tangent = glm::normalize(glm::cross(direction, up));
+			float angle = glm::atan2(tangent.x, tangent.z);
+
+			glm::mat4 spaceship_tmat = glm::translate(glm::mat4(1.f), direction);
+			glm::mat4 spaceship_rmat = glm::rotate(glm::mat4(1.f), angle, glm::vec3(0.f, 1.f, 0.f));
+			glm::mat4 spaceship_smat = glm::scale(glm::vec3(.25f, .25f, .25f));
+			m_spaceship->Update(spaceship_tmat * spaceship_rmat * spaceship_smat);
+
+			particle_ship_origin = glm::translate(spaceship_tmat * spaceship_rmat, glm::vec3(.0f, .0f, -1.f));
+			particle_ship_velocity = glm::normalize(glm::vec3(spaceship_tmat * spaceship_rmat * glm::vec4(0.f, 0.f, -1.f, 0.f)));
+
+			//Ship Lights
+			glm::vec3 light_direction = glm::vec3(cos(spaceship_speed * elapsed_time - .04f) * spaceship_radius, 5.f, sin(spaceship_speed * elapsed_time - .04f) * spaceship_radius); //Light trails behind spaceship
+			glm::mat4 light0_tmat = glm::translate(glm::mat4(1.f), light_direction);
+			m_point_light0->Update(light0_tmat);
+		});
+		JobSystem::Job* ship_particles = m_jobs->CreateJob([this, dt]()
+		{
+			m_ship_particle->emitParticles(dt, particle_ship_origin[3], particle_ship_velocity);
+		});
+		m_jobs->AddDependency(spaceship, ship_particles);
 
 		//Comet
-		float comet_radius = 85.f;
-		float comet_speed = .1f;
-		float comet_particle_speed = 5.f;
-
-		glm::vec3 comet_direction = glm::vec3(0.f, cos(comet_speed * elapsed_time) * comet_radius, sin(comet_speed * elapsed_time) * comet_radius * 2);
-		glm::mat4 comet_tmat = glm::translate(glm::mat4(1.f), comet_direction);
-		m_comet->Update(comet_tmat);
+		JobSystem::Job* comet = m_jobs->CreateJob([this, elapsed_time]()
+		{
+			float comet_radius = 85.f;
+			float comet_speed = .1f;
+
+			glm::vec3 comet_direction = glm::vec3(0.f, cos(comet_speed * elapsed_time) * comet_radius, sin(comet_speed * elapsed_time) * comet_radius * 2);
+			glm::mat4 comet_tmat = glm::translate(glm::mat4(1.f), comet_direction);
+			m_comet->Update(comet_tmat);
+		});
+		JobSystem::Job* comet_particles = m_jobs->CreateJob([this, dt]()
+		{
+			m_comet_particle->emitParticles(dt, m_comet->getPosition(), glm::vec3(0.f));
+		});
+		m_jobs->AddDependency(comet, comet_particles);
 
-		m_comet_particle->emitParticles(dt, m_comet->getPosition(), glm::vec3(0.f));
+		JobSystem::Job* sun_particles = m_jobs->CreateJob([this, dt]()
+		{
+			m_sun_particle->emitParticles(dt, glm::vec3(0.f), glm::vec3(0.f));
+		});
 
 		//--------------------Solar System transform
-		//sun transform
-		computeTransforms(dt, { 0.f, 0.f, 0.f }, { 0.f, 0.f, 0.f }, { 0.05f, 0.0f, 0.05f }, { 2.f, 2.f, 2.f }, glm::vec3(0.0f, 1.0f, 0.0f), tmat, rmat, smat);
-		planet_stack.push(std::make_pair("sun", tmat * rmat * smat));
-
-		m_sun_particle->emitParticles(dt, glm::vec3(0.f), glm::vec3(0.f));
-
-		//jupiter transform
-		computeTransforms(dt, { 0.06f, 0.f, 0.06f }, { 82.f, 0.f, 82.f }, { 0.03f, 0.0f, 0.03f }, { 8.f, 8.f, 8.f }, glm::vec3(0.0f, 1.0f, 0.0f), tmat, rmat, smat);
-		std::pair<std::string, glm::mat4> juptier_transform = std::make_pair("jupiter", planet_stack.top().second * tmat * rmat * smat);
-
-		//earth transform
-		computeTransforms(dt, { 0.10f, 0.0f, 0.10f }, { 40.f, 0.0f, 40.0f }, { 0.15f, 0.0f, 0.15f }, { 2.f, 2.f, 2.f }, glm::vec3(0.0f, 1.0f, 0.0f), tmat, rmat, smat);
-		planet_stack.push(std::make_pair("earth", planet_stack.top().second * tmat * rmat * smat));
+		JobSystem::Job* solar_system = m_jobs->CreateJob([this, dt]()
+		{
+			updateSolarSystem(dt);
+		});
 
-		//moon transform
-		computeTransforms(dt, { 0.1f, 0.1f, 0.f }, { 5.f, 5.f, 0.f }, { 0.15f, 0.0f, 0.15f }, { .5f, .5f, .5f }, glm::vec3(0.f, 1.f, 0.f), tmat, rmat, smat);
-		planet_stack.push(std::make_pair("moon", planet_stack.top().second * tmat * rmat * smat));
+		std::vector<JobSystem::Job*> frame_jobs = { engine_particles1, engine_particles2, spaceship, ship_particles, comet, comet_particles, sun_particles, solar_system };
+		for (JobSystem::Job* job : frame_jobs)
+		{
+			m_jobs->AddDependency(job, frame_done);
+		}
+		for (JobSystem::Job* job : frame_jobs)
+		{
+			m_jobs->Submit(job);
+		}
+		m_jobs->Submit(frame_done);
+		m_jobs->Wait(frame_done);
 
-		planet_stack.push(juptier_transform);
+		m_camera->EndStep();
+	}
 
-		//jupiter moon transform
-		computeTransforms(dt, { 0.1f, 0.1f, 0.f }, { 1.5f, 1.5f, 0.f }, { 0.15f, 0.0f, 0.15f }, { .1f, .1f, .1f }, glm::vec3(0.f, 1.f, 0.f), tmat, rmat, smat);
-		planet_stack.push(std::make_pair("j_moon", planet_stack.top().second * tmat * rmat * smat));
+	void updateSolarSystem(double dt)
+	{
+		computeSolarSystem(sim_time, planet_stack);
 
 		if (!visiting) //Find closest planet
 		{
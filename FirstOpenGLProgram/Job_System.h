@@ -0,0 +1,228 @@
+#pragma once
+#ifndef JOB_SYSTEM_H
+#define JOB_SYSTEM_H
+
+#include "Core_Header.h"
+
+class JobSystem
+{
+public:
+	struct Job
+	{
+		std::function<void()> task;
+		std::vector<Job*> dependents;
+		std::atomic<int> unfinished_dependencies{ 0 };
+		std::atomic<bool> finished{ false };
+	};
+
+private:
+	struct WorkQueue
+	{
+		std::mutex lock;
+		std::deque<Job*> jobs;
+	};
+
+	std::vector<std::thread> workers;
+	std::vector<WorkQueue*> queues; //Index 0 belongs to the main thread
+	std::deque<Job> job_pool; //Deque keeps job pointers stable while the frame's graph grows
+	unsigned int jobs_used = 0;
+
+	std::mutex sleep_lock;
+	std::condition_variable wake_condition;
+	std::atomic<int> queued_jobs{ 0 };
+	std::atomic<int> unfinished_jobs{ 0 };
+	std::atomic<bool> running{ false };
+
+	static unsigned int& workerIndex()
+	{
+		static thread_local unsigned int worker_index = 0;
+		return worker_index;
+	}
+
+	void pushJob(Job* job)
+	{
+		WorkQueue* queue = queues[workerIndex()];
+		{
+			std::lock_guard<std::mutex> guard(queue->lock);
+			queue->jobs.push_back(job);
+		}
+		queued_jobs++;
+
+		//Taking the sleep lock orders this push against a worker that is about to wait
+		{
+			std::lock_guard<std::mutex> guard(sleep_lock);
+		}
+		wake_condition.notify_one();
+	}
+
+	Job* popJob()
+	{
+		unsigned int own_index = workerIndex();
+
+		//Newest job from our own queue first, it is most likely still in cache
+		{
+			WorkQueue* queue = queues[own_index];
+			std::lock_guard<std::mutex> guard(queue->lock);
+			if (!queue->jobs.empty())
+			{
+				Job* job = queue->jobs.back();
+				queue->jobs.pop_back();
+				queued_jobs--;
+				return job;
+			}
+		}
+
+		//Steal the oldest job from another queue
+		for (unsigned int i = 1; i < queues.size(); i++)
+		{
+			WorkQueue* victim = queues[(own_index + i) % queues.size()];
+			std::lock_guard<std::mutex> guard(victim->lock);
+			if (!victim->jobs.empty())
+			{
+				Job* job = victim->jobs.front();
+				victim->jobs.pop_front();
+				queued_jobs--;
+				return job;
+			}
+		}
+		return NULL;
+	}
+
+	void execute(Job* job)
+	{
+		if (job->task) { job->task(); }
+
+		for (Job* dependent : job->dependents)
+		{
+			if (--dependent->unfinished_dependencies == 0) { pushJob(dependent); }
+		}
+		job->finished = true;
+		unfinished_jobs--; //Last touch of the job, after this its slot may be recycled
+	}
+
+	void workerLoop(unsigned int index)
+	{
+		workerIndex() = index;
+
+		while (running)
+		{
+			Job* job = popJob();
+			if (job)
+			{
+				execute(job);
+			}
+			else
+			{
+				std::unique_lock<std::mutex> guard(sleep_lock);
+				wake_condition.wait(guard, [this] { return queued_jobs > 0 || !running; });
+			}
+		}
+	}
+
+public:
+	JobSystem()
+	{
+		workerIndex() = 0;
+		queues.push_back(new WorkQueue());
+	}
+
+	~JobSystem()
+	{
+		{
+			std::lock_guard<std::mutex> guard(sleep_lock);
+			running = false;
+		}
+		wake_condition.notify_all();
+
+		for (std::thread& worker : workers) { worker.join(); }
+		for (WorkQueue* queue : queues) { delete queue; }
+		queues.clear();
+	}
+
+	bool Initialize(unsigned int worker_count = std::thread::hardware_concurrency())
+	{
+		running = true;
+
+		//The main thread also runs jobs while it waits, so it counts as one of the workers
+		for (unsigned int i = 1; i < worker_count; i++) { queues.push_back(new WorkQueue()); }
+		for (unsigned int i = 1; i < worker_count; i++)
+		{
+			workers.push_back(std::thread(&JobSystem::workerLoop, this, i));
+		}
+		return true;
+	}
+
+	unsigned int getWorkerCount()
+	{
+		return queues.size();
+	}
+
+	//Jobs are recycled every frame, so this waits for the previous frame's graph to drain first.
+	void BeginFrame()
+	{
+		while (unfinished_jobs > 0)
+		{
+			Job* job = popJob();
+			if (job) { execute(job); }
+			else { std::this_thread::yield(); }
+		}
+		jobs_used = 0;
+	}
+
+	Job* CreateJob(std::function<void()> task)
+	{
+		if (jobs_used == job_pool.size()) { job_pool.emplace_back(); }
+
+		Job* job = &job_pool[jobs_used++];
+		job->task = task;
+		job->dependents.clear();
+		job->unfinished_dependencies = 1; //Held until Submit so dependencies can still be added
+		job->finished = false;
+		unfinished_jobs++;
+		return job;
+	}
+
+	//Must be called before either job is submitted.
+	void AddDependency(Job* before, Job* after)
+	{
+		before->dependents.push_back(after);
+		after->unfinished_dependencies++;
+	}
+
+	//Every created job has to be submitted once, it then runs as soon as its dependencies finish.
+	void Submit(Job* job)
+	{
+		if (--job->unfinished_dependencies == 0) { pushJob(job); }
+	}
+
+	void Wait(Job* job)
+	{
+		while (!job->finished)
+		{
+			Job* next_job = popJob();
+			if (next_job) { execute(next_job); }
+			else { std::this_thread::yield(); }
+		}
+	}
+
+	//Splits [0, count) into batches run on every worker and returns when all are done. Main thread only.
+	void ParallelFor(unsigned int count, unsigned int batch_size, std::function<void(unsigned int, unsigned int)> task)
+	{
+		Job* done = CreateJob(NULL);
+		std::vector<Job*> batches;
+
+		for (unsigned int begin = 0; begin < count; begin += batch_size)
+		{
+			unsigned int end = std::min(begin + batch_size, count);
+			Job* batch = CreateJob([task, begin, end]() { task(begin, end); });
+			AddDependency(batch, done);
+			batches.push_back(batch);
+		}
+
+		for (Job* batch : batches) { Submit(batch); }
+		Submit(done);
+		Wait(done);
+	}
+};
+
+#endif
@@ -0,0 +1,202 @@
+#pragma once
+#ifndef LIGHT_CLUSTERS_H
+#define LIGHT_CLUSTERS_H
+
+#include "Core_Header.h"
+
+struct Point_Light
+{
+	glm::vec3 position;
+	glm::vec3 ambient;
+	glm::vec3 diffuse;
+	glm::vec3 specular;
+	float constant;
+	float linear;
+	float quadratic;
+};
+
+//Bins point lights into view space clusters on the CPU. ClusteredLights uploads the result for the shaders.
+class LightClusters
+{
+public:
+	//View space froxels, tiles across the screen and exponential slices in depth
+	static const unsigned int GRID_X = 16;
+	static const unsigned int GRID_Y = 9;
+	static const unsigned int GRID_Z = 24;
+	static const unsigned int CLUSTER_COUNT = GRID_X * GRID_Y * GRID_Z;
+
+protected:
+	const float CLUSTER_NEAR = 1.f; //Everything closer than this shares the first slice, very thin slices near the camera would be wasted
+	const float LIGHT_THRESHOLD = 1.f / 256.f; //Lights are cut off once they add less than this
+
+	struct Gpu_Point_Light
+	{ //std430 layout, each vec4 carries one scalar in w
+		glm::vec4 position_radius;
+		glm::vec4 ambient_constant;
+		glm::vec4 diffuse_linear;
+		glm::vec4 specular_quadratic;
+	};
+
+	struct Light_Cluster
+	{ //Matches the uvec2 read by the fragment shader
+		unsigned int offset;
+		unsigned int count;
+	};
+
+	struct Cluster_Bounds
+	{
+		glm::vec3 min, max;
+	};
+
+	std::vector<Point_Light> lights;
+	std::vector<float> radii;
+
+	//Rebuilt every frame, kept as members so binning does not allocate
+	std::vector<Gpu_Point_Light> gpu_lights;
+	std::vector<Light_Cluster> clusters;
+	std::vector<unsigned int> indices;
+	std::vector<std::pair<unsigned int, unsigned int>> assignments; //Cluster and light
+
+	std::vector<Cluster_Bounds> bounds;
+	glm::mat4 bounds_projection = glm::mat4(0.f);
+	float near_plane = 0.f, far_plane = 0.f;
+	float slice_scale = 0.f, slice_bias = 0.f;
+
+	float sliceDepth(unsigned int slice)
+	{
+		if (slice == 0) { return near_plane; }
+		return CLUSTER_NEAR * pow(far_plane / CLUSTER_NEAR, (float)slice / GRID_Z);
+	}
+
+	int slice(float depth)
+	{
+		if (depth <= CLUSTER_NEAR) { return 0; }
+		return std::min((int)GRID_Z - 1, (int)(log(depth) * slice_scale + slice_bias));
+	}
+
+	void buildBounds(const glm::mat4& projection)
+	{ //Only needed when the projection changes, e.g. when the field of view is zoomed
+		bounds_projection = projection;
+		near_plane = projection[3][2] / (projection[2][2] - 1.f);
+		far_plane = projection[3][2] / (projection[2][2] + 1.f);
+		slice_scale = GRID_Z / log(far_plane / CLUSTER_NEAR);
+		slice_bias = -GRID_Z * log(CLUSTER_NEAR) / log(far_plane / CLUSTER_NEAR);
+
+		bounds.resize(CLUSTER_COUNT);
+		for (unsigned int z = 0; z < GRID_Z; z++)
+		{
+			float depths[2] = { sliceDepth(z), sliceDepth(z + 1) };
+			for (unsigned int y = 0; y < GRID_Y; y++)
+			{
+				for (unsigned int x = 0; x < GRID_X; x++)
+				{
+					Cluster_Bounds& cluster = bounds[x + y * GRID_X + z * GRID_X * GRID_Y];
+					cluster.min = glm::vec3(FLT_MAX);
+					cluster.max = glm::vec3(-FLT_MAX);
+
+					//Corners of the tile on the near and far depth of the slice
+					for (float depth : depths)
+					{
+						for (unsigned int corner = 0; corner < 4; corner++)
+						{
+							float ndc_x = -1.f + 2.f * (x + (corner & 1)) / GRID_X;
+							float ndc_y = -1.f + 2.f * (y + (corner >> 1)) / GRID_Y;
+							glm::vec3 point(ndc_x * depth / projection[0][0], ndc_y * depth / projection[1][1], -depth);
+							cluster.min = glm::min(cluster.min, point);
+							cluster.max = glm::max(cluster.max, point);
+						}
+					}
+				}
+			}
+		}
+	}
+
+	static bool sphereIntersects(const Cluster_Bounds& cluster, const glm::vec3& center, float radius)
+	{
+		glm::vec3 closest = glm::clamp(center, cluster.min, cluster.max);
+		glm::vec3 offset = closest - center;
+		return glm::dot(offset, offset) <= radius * radius;
+	}
+
+public:
+	//Distance where a light's brightest channel falls below the threshold
+	float LightRadius(const Point_Light& light)
+	{
+		float brightest = glm::max(glm::max(light.ambient.x + light.diffuse.x + light.specular.x, light.ambient.y + light.diffuse.y + light.specular.y),
+			light.ambient.z + light.diffuse.z + light.specular.z);
+		float target = brightest / LIGHT_THRESHOLD - light.constant; //Solve quadratic * d^2 + linear * d = target
+
+		if (target <= 0.f) { return 0.f; }
+		if (light.quadratic > 0.f) { return (-light.linear + sqrt(light.linear * light.linear + 4.f * light.quadratic * target)) / (2.f * light.quadratic); }
+		if (light.linear > 0.f) { return target / light.linear; }
+		return FLT_MAX; //Constant attenuation never fades
+	}
+
+	unsigned int AddLight(const Point_Light& light)
+	{
+		lights.push_back(light);
+		radii.push_back(LightRadius(light));
+		return lights.size() - 1;
+	}
+
+	void setPosition(unsigned int light, glm::vec3 position)
+	{
+		lights[light].position = position;
+	}
+
+	unsigned int getLightCount()
+	{
+		return lights.size();
+	}
+
+	//Assigns every light to the clusters its sphere touches. Needs no GL state.
+	void Bin(const glm::mat4& view, const glm::mat4& projection)
+	{
+		if (projection != bounds_projection) { buildBounds(projection); }
+
+		assignments.clear();
+		gpu_lights.resize(lights.size());
+		for (unsigned int i = 0; i < lights.size(); i++)
+		{
+			const Point_Light& light = lights[i];
+			gpu_lights[i] = { glm::vec4(light.position, radii[i]), glm::vec4(light.ambient, light.constant),
+				glm::vec4(light.diffuse, light.linear), glm::vec4(light.specular, light.quadratic) };
+
+			glm::vec3 center = glm::vec3(view * glm::vec4(light.position, 1.f));
+			float depth = -center.z;
+			float radius = radii[i];
+			if (depth + radius < near_plane || depth - radius > far_plane) { continue; }
+
+			int first_slice = slice(std::max(depth - radius, near_plane));
+			int last_slice = slice(std::min(depth + radius, far_plane));
+			for (int z = first_slice; z <= last_slice; z++)
+			{
+				for (unsigned int cluster = z * GRID_X * GRID_Y; cluster < (z + 1) * GRID_X * GRID_Y; cluster++)
+				{
+					if (sphereIntersects(bounds[cluster], center, radius)) { assignments.push_back(std::make_pair(cluster, i)); }
+				}
+			}
+		}
+
+		//Counting sort by cluster, so each cluster's lights are one contiguous run in the index list
+		clusters.assign(CLUSTER_COUNT, { 0, 0 });
+		for (const auto& assignment : assignments) { clusters[assignment.first].count++; }
+
+		unsigned int offset = 0;
+		for (Light_Cluster& cluster : clusters)
+		{
+			cluster.offset = offset;
+			offset += cluster.count;
+			cluster.count = 0;
+		}
+
+		indices.resize(std::max((size_t)1, assignments.size())); //Empty storage buffers cannot be bound
+		for (const auto& assignment : assignments)
+		{
+			Light_Cluster& cluster = clusters[assignment.first];
+			indices[cluster.offset + cluster.count++] = assignment.second;
+		}
+	}
+};
+
+#endif
@@ -2,15 +2,7 @@
 #ifndef MAIN_HEADER_H
 #define MAIN_HEADER_H
 
-#include <glm/glm.hpp>
-#include <glm/gtc/matrix_transform.hpp>
-#include <glm/gtc/type_ptr.hpp>
-#include <glm/gtc/random.hpp>
-
-#define GLM_ENABLE_EXPERIMENTAL
-#include <glm/gtx/rotate_vector.hpp>
-#include<glm/gtx/vector_angle.hpp>
-#include "glm/ext.hpp"
+#include "Core_Header.h"
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
@@ -22,12 +14,4 @@
 
 #include "stb_image.h"
 
-#include <iostream>
-#include <fstream>
-#include <sstream>
-#include <vector>
-#include <string>
-#include <stack>
-#include <map>
-
 #endif
@@ -0,0 +1,147 @@
+#pragma once
+#ifndef MEMORY_TRACKER_H
+#define MEMORY_TRACKER_H
+
+#include "Main_Header.h"
+
+class MemoryTracker
+{
+public:
+	enum Category
+	{
+		VERTEX_BUFFER,
+		INDEX_BUFFER,
+		INSTANCE_BUFFER,
+		STORAGE_BUFFER,
+		TEXTURE,
+		RENDER_TARGET,
+		STAGING_BUFFER,
+		CATEGORY_COUNT
+	};
+
+private:
+	struct Allocation
+	{
+		Category category;
+		std::string owner;
+		size_t bytes;
+	};
+
+	//Keyed by object type and name, GL names are only unique per type
+	std::map<std::pair<GLenum, GLuint>, Allocation> allocations;
+	size_t category_bytes[CATEGORY_COUNT] = {};
+	size_t resident_bytes = 0;
+	size_t peak_bytes = 0;
+	size_t budget_bytes = 0; //0 means no budget
+	bool over_budget = false;
+
+	static const char* categoryName(Category category)
+	{
+		switch (category)
+		{
+		case VERTEX_BUFFER: return "Vertex Buffers";
+		case INDEX_BUFFER: return "Index Buffers";
+		case INSTANCE_BUFFER: return "Instance Buffers";
+		case STORAGE_BUFFER: return "Storage Buffers";
+		case TEXTURE: return "Textures";
+		case RENDER_TARGET: return "Render Targets";
+		case STAGING_BUFFER: return "Staging Buffers";
+		default: return "Other";
+		}
+	}
+
+	static std::string formatBytes(size_t bytes)
+	{
+		char text[32];
+		snprintf(text, sizeof(text), "%.2f MB", bytes / (1024.0 * 1024.0));
+		return text;
+	}
+
+public:
+	//Sizes are estimates from the requested storage, drivers may pad or compress.
+	static size_t TextureBytes(int width, int height, int bytes_per_texel, bool mipmapped)
+	{
+		size_t bytes = (size_t)width * height * bytes_per_texel;
+		return mipmapped ? bytes * 4 / 3 : bytes; //A full mip chain adds a third
+	}
+
+	//Registering an object again replaces its old size, as glBufferData and glTexImage2D do.
+	void Allocate(GLenum identifier, GLuint name, Category category, const std::string& owner, size_t bytes)
+	{
+		Free(identifier, name);
+
+		allocations[std::make_pair(identifier, name)] = { category, owner, bytes };
+		category_bytes[category] += bytes;
+		resident_bytes += bytes;
+		peak_bytes = std::max(peak_bytes, resident_bytes);
+
+		if (budget_bytes > 0 && resident_bytes > budget_bytes && !over_budget)
+		{
+			std::cerr << "Warning: GPU memory budget exceeded! " << formatBytes(resident_bytes) << " of " << formatBytes(budget_bytes)
+				<< " after " << owner << std::endl;
+			over_budget = true;
+		}
+	}
+
+	void Free(GLenum identifier, GLuint name)
+	{
+		auto allocation = allocations.find(std::make_pair(identifier, name));
+		if (allocation == allocations.end()) { return; }
+
+		category_bytes[allocation->second.category] -= allocation->second.bytes;
+		resident_bytes -= allocation->second.bytes;
+		allocations.erase(allocation);
+
+		if (budget_bytes > 0 && resident_bytes <= budget_bytes) { over_budget = false; }
+	}
+
+	void setBudget(size_t bytes)
+	{
+		budget_bytes = bytes;
+		over_budget = false;
+	}
+
+	size_t getResidentBytes()
+	{
+		return resident_bytes;
+	}
+
+	size_t getPeakBytes()
+	{
+		return peak_bytes;
+	}
+
+	size_t getCategoryBytes(Category category)
+	{
+		return category_bytes[category];
+	}
+
+	void PrintReport(std::ostream& out)
+	{
+		out << "GPU Memory: " << formatBytes(resident_bytes) << " resident, " << formatBytes(peak_bytes) << " peak";
+		if (budget_bytes > 0) { out << ", " << formatBytes(budget_bytes) << " budget"; }
+		out << std::endl;
+
+		for (int i = 0; i < CATEGORY_COUNT; i++)
+		{
+			out << "  " << std::left << std::setw(20) << categoryName((Category)i) << std::right << formatBytes(category_bytes[i]) << std::endl;
+		}
+
+		//Largest owners first, assets are what gets resized for smaller targets
+		std::map<std::string, size_t> owner_bytes;
+		for (const auto& allocation : allocations) { owner_bytes[allocation.second.owner] += allocation.second.bytes; }
+
+		std::vector<std::pair<std::string, size_t>> owners(owner_bytes.begin(), owner_bytes.end());
+		std::sort(owners.begin(), owners.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+
+		out << "  Largest owners:" << std::endl;
+		for (unsigned int i = 0; i < owners.size() && i < 10; i++)
+		{
+			out << "    " << std::setw(10) << formatBytes(owners[i].second) << "  " << owners[i].first << std::endl;
+		}
+	}
+};
+
+MemoryTracker memory_tracker;
+
+#endif
@@ -4,6 +4,11 @@
 
 #include "Main_Header.h"
 #include "Shader.h"
+#include "Shader_Variants.h"
+#include "Render_Stats.h"
+#include "Debug_Output.h"
+#include "Memory_Tracker.h"
+#include "Orbit_Instance.h"
 
 #define MAX_BONE_INFLUENCE 4
 
@@ -31,12 +36,37 @@ private:
 	std::vector<Vertex> vertices;
 	std::vector<unsigned int> indices;
 	std::vector<Model_Texture> textures;
-	std::vector<glm::mat4> instanceMatrices;
+	unsigned int instance_count = 0;
+	unsigned int material_features = 0; //Shader features the textures can feed
+	float opacity; //Below 1 the mesh is drawn with the transparent geometry instead of the opaque models
 
 	unsigned int instanceVB, VB, IB, VAO;
-	unsigned int outlineVB, outlineIB, outlineVAO;
+	unsigned int depthVAO; //Positions only, over the same buffers
 
-	void Initialize()
+	//Instanced meshes draw every instance, or only the ranges given
+	void drawElements(const std::vector<Instance_Range>* ranges)
+	{
+		if (instance_count == 0)
+		{
+			glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+			render_stats.CountDraw(indices.size() / 3);
+		}
+		else if (!ranges)
+		{
+			glDrawElementsInstanced(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0, instance_count);
+			render_stats.CountDraw(indices.size() / 3, instance_count);
+		}
+		else
+		{
+			for (const Instance_Range& range : *ranges)
+			{
+				glDrawElementsInstancedBaseInstance(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0, range.count, range.first);
+				render_stats.CountDraw(indices.size() / 3, range.count);
+			}
+		}
+	}
+
+	void Initialize(const std::vector<Orbit_Instance>& instances, const std::string& owner)
 	{
 		glGenVertexArrays(1, &VAO);
 		glBindVertexArray(VAO);
@@ -46,8 +76,10 @@ private:
 
 		glBindBuffer(GL_ARRAY_BUFFER, VB);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
+		render_stats.CountBufferUpload(sizeof(Vertex) * vertices.size());
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IB);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), &indices[0], GL_STATIC_DRAW);
+		render_stats.CountBufferUpload(sizeof(unsigned int) * indices.size());
 
 		glEnableVertexAttribArray(0);
 		glEnableVertexAttribArray(1);
@@ -61,52 +93,88 @@ private:
 		glVertexAttribPointer(3, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, tangent));
 		glVertexAttribPointer(4, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)offsetof(Vertex, bitangents));
 
-		if (instanceMatrices.size() > 1)
-		{
+		instance_count = instances.size();
+		if (instance_count > 0)
+		{ //Only the GPU copy is kept, large belts would otherwise hold their instances in memory twice
 			glGenBuffers(1, &instanceVB);
 			glBindBuffer(GL_ARRAY_BUFFER, instanceVB);
-			glBufferData(GL_ARRAY_BUFFER, sizeof(glm::mat4) * instanceMatrices.size(), &instanceMatrices[0], GL_STATIC_DRAW);
+			glBufferData(GL_ARRAY_BUFFER, sizeof(Orbit_Instance) * instances.size(), &instances[0], GL_STATIC_DRAW);
+			render_stats.CountBufferUpload(sizeof(Orbit_Instance) * instances.size());
 
-			for (int i = 0; i < 4; i++)
+			for (int i = 0; i < 2; i++)
 			{
 				glEnableVertexAttribArray(5 + i);
-				glVertexAttribPointer(5 + i, 4, GL_FLOAT, GL_FALSE, sizeof(glm::mat4), (void*)(sizeof(glm::vec4) * i));
+				glVertexAttribPointer(5 + i, 4, GL_FLOAT, GL_FALSE, sizeof(Orbit_Instance), (void*)(sizeof(glm::vec4) * i));
 				glVertexAttribDivisor(5 + i, 1);
 			}
 			glBindBuffer(GL_ARRAY_BUFFER, 0);
 		}
 		glBindVertexArray(0);
 
-		//Outline VAO
-		glGenVertexArrays(1, &outlineVAO);
-		glBindVertexArray(outlineVAO);
-
-		glGenBuffers(1, &outlineVB);
-		glGenBuffers(1, &outlineIB);
+		memory_tracker.Allocate(GL_BUFFER, VB, MemoryTracker::VERTEX_BUFFER, owner, sizeof(Vertex) * vertices.size());
+		memory_tracker.Allocate(GL_BUFFER, IB, MemoryTracker::INDEX_BUFFER, owner, sizeof(unsigned int) * indices.size());
+		if (instance_count > 0) { memory_tracker.Allocate(GL_BUFFER, instanceVB, MemoryTracker::INSTANCE_BUFFER, owner, sizeof(Orbit_Instance) * instance_count); }
 
-		glBindBuffer(GL_ARRAY_BUFFER, outlineVB);
-		glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * vertices.size(), &vertices[0], GL_STATIC_DRAW);
-		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, outlineIB);
-		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * indices.size(), &indices[0], GL_STATIC_DRAW);
+		//Depth VAO, only enables the position attribute so depth passes skip fetching the rest of each vertex
+		glGenVertexArrays(1, &depthVAO);
+		glBindVertexArray(depthVAO);
 
+		glBindBuffer(GL_ARRAY_BUFFER, VB);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IB);
 		glEnableVertexAttribArray(0);
 		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(Vertex), (void*)0);
 
+		if (instance_count > 0)
+		{
+			glBindBuffer(GL_ARRAY_BUFFER, instanceVB);
+			for (int i = 0; i < 2; i++)
+			{
+				glEnableVertexAttribArray(5 + i);
+				glVertexAttribPointer(5 + i, 4, GL_FLOAT, GL_FALSE, sizeof(Orbit_Instance), (void*)(sizeof(glm::vec4) * i));
+				glVertexAttribDivisor(5 + i, 1);
+			}
+			glBindBuffer(GL_ARRAY_BUFFER, 0);
+		}
+
 		glBindVertexArray(0);
+
+		debug_output.Label(GL_VERTEX_ARRAY, VAO, owner + " VAO");
+		debug_output.Label(GL_BUFFER, VB, owner + " Vertices");
+		debug_output.Label(GL_BUFFER, IB, owner + " Indices");
+		if (instance_count > 0) { debug_output.Label(GL_BUFFER, instanceVB, owner + " Instances"); }
+		debug_output.Label(GL_VERTEX_ARRAY, depthVAO, owner + " Depth VAO");
 	}
 
 public:
-	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Model_Texture> textures, std::vector<glm::mat4> instances)
+	Mesh(std::vector<Vertex> vertices, std::vector<unsigned int> indices, std::vector<Model_Texture> textures, const std::vector<Orbit_Instance>& instances, const std::string& owner, float opacity = 1.f)
 	{
 		this->vertices = vertices;
 		this->indices = indices;
 		this->textures = textures;
-		this->instanceMatrices = instances;
+		this->opacity = opacity;
 
-		Initialize();
+		for (const Model_Texture& texture : textures)
+		{
+			if (texture.type == "texture_normal") { material_features |= ShaderVariants::NORMAL_MAP; }
+			else if (texture.type == "texture_emission") { material_features |= ShaderVariants::EMISSIVE; }
+		}
+		if (instances.size() > 0) { material_features |= ShaderVariants::INSTANCED; }
+		if (opacity < 1.f) { material_features |= ShaderVariants::TRANSPARENT; }
+
+		Initialize(instances, owner);
+	}
+
+	//Variant features for drawing this mesh. Normal maps are used whenever the mesh has one, instancing whenever it has instances
+	//and transparency whenever it is see-through, requested features are dropped when the mesh has no texture for them.
+	unsigned int getFeatures(unsigned int requested)
+	{
+		unsigned int features = requested | (material_features & ~ShaderVariants::EMISSIVE);
+		if (!(material_features & ShaderVariants::EMISSIVE)) { features &= ~ShaderVariants::EMISSIVE; }
+		return features;
 	}
 	
-	void Render(Shader &shader)
+	//Features decide which textures the variant samples, the rest are not bound
+	void Render(Shader &shader, unsigned int features = ~0u, const std::vector<Instance_Range>* ranges = NULL)
 	{
 		//Bind appropriate textures
 		unsigned int diffuse_n = 1, specular_n = 1, normal_n = 1, height_n = 1, emission_n = 1;
@@ -116,33 +184,51 @@ public:
 			std::string number;
 			std::string name = textures[i].type;
 
+			if (name == "texture_normal" && !(features & ShaderVariants::NORMAL_MAP)) { continue; }
+			if (name == "texture_emission" && !(features & ShaderVariants::EMISSIVE)) { continue; }
+
 			if (name == "texture_diffuse") { number = std::to_string(diffuse_n++); }
 			else if (name == "texture_specular") { number = std::to_string(specular_n++); }
 			else if (name == "texture_normal") { number = std::to_string(normal_n++); }
 			else if (name == "texture_height") { number = std::to_string(height_n++); }
 			else if (name == "texture_emission") { number = std::to_string(emission_n++); }
 
-			glUniform1i(shader.GetUniformLocation(("material." + name + number).c_str()), i);
+			uploadUniform(glUniform1i, shader.GetUniformLocation(("material." + name + number).c_str()), i);
 			glActiveTexture(GL_TEXTURE0 + i);
 			glBindTexture(GL_TEXTURE_2D, textures[i].id);
+			render_stats.CountTexture();
 		}
+		if ((features & material_features) & ShaderVariants::TRANSPARENT) { uploadUniform(glUniform1f, shader.GetUniformLocation("material.alpha"), opacity); }
 
 		glBindVertexArray(VAO);
-		if (instanceMatrices.size() > 1)
-		{
-			glDrawElementsInstanced(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0, instanceMatrices.size());
-		}
-		else
-		{
-			glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
-		}
+		render_stats.CountVertexArray();
+		drawElements(ranges);
 		glBindVertexArray(0);
 	}
 
-	void RenderOutline()
+	bool isTransparent()
+	{
+		return opacity < 1.f;
+	}
+
+	//Unique vertices per draw, every instance counts
+	unsigned long long getVertexCount()
+	{
+		return (unsigned long long)vertices.size() * std::max(1u, instance_count);
+	}
+
+	//Indices drawn per draw, every instance counts. The post transform cache shades fewer vertices than this.
+	unsigned long long getIndexCount()
+	{
+		return (unsigned long long)indices.size() * std::max(1u, instance_count);
+	}
+
+	//Positions only, for the depth pre-pass and shadow maps
+	void RenderDepth(const std::vector<Instance_Range>* ranges = NULL)
 	{
-		glBindVertexArray(outlineVAO);
-		glDrawElements(GL_TRIANGLES, indices.size(), GL_UNSIGNED_INT, 0);
+		glBindVertexArray(depthVAO);
+		render_stats.CountVertexArray();
+		drawElements(ranges);
 		glBindVertexArray(0);
 	}
 };
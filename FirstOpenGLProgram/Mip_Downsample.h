@@ -0,0 +1,29 @@
+#pragma once
+#ifndef MIP_DOWNSAMPLE_H
+#define MIP_DOWNSAMPLE_H
+
+#include "Core_Header.h"
+
+//2x2 box filter to the next mip level, odd edges repeat their last row or column
+std::vector<unsigned char> downsampleMip(const std::vector<unsigned char>& source, int width, int height, int channels)
+{
+	int next_width = std::max(1, width / 2), next_height = std::max(1, height / 2);
+	std::vector<unsigned char> result((size_t)next_width * next_height * channels);
+	for (int y = 0; y < next_height; y++)
+	{
+		const unsigned char* row0 = &source[(size_t)std::min(2 * y, height - 1) * width * channels];
+		const unsigned char* row1 = &source[(size_t)std::min(2 * y + 1, height - 1) * width * channels];
+		unsigned char* out = &result[(size_t)y * next_width * channels];
+		for (int x = 0; x < next_width; x++)
+		{
+			int x0 = std::min(2 * x, width - 1) * channels, x1 = std::min(2 * x + 1, width - 1) * channels;
+			for (int c = 0; c < channels; c++)
+			{
+				*out++ = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) >> 2);
+			}
+		}
+	}
+	return result;
+}
+
+#endif
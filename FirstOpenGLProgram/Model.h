@@ -5,8 +5,40 @@
 #include "Main_Header.h"
 #include "Mesh.h"
 #include "Shader.h"
+#include "Texture_Streamer.h"
 
-unsigned int TextureFromFile(const char* texture_path, const std::string &directory, bool gamma = false);
+unsigned int TextureFromFile(const char* texture_path, const std::string &directory, const std::string& type_name, bool gamma = false);
+
+glm::mat4 interpolateTransform(const glm::mat4& start, const glm::mat4& end, float f)
+{ //Blends translation and scale linearly and rotation spherically, so orbiting models keep their shape.
+	glm::vec3 start_scale = glm::vec3(glm::length(glm::vec3(start[0])), glm::length(glm::vec3(start[1])), glm::length(glm::vec3(start[2])));
+	glm::vec3 end_scale = glm::vec3(glm::length(glm::vec3(end[0])), glm::length(glm::vec3(end[1])), glm::length(glm::vec3(end[2])));
+
+	if (glm::min(start_scale.x, glm::min(start_scale.y, start_scale.z)) < 0.000001f || glm::min(end_scale.x, glm::min(end_scale.y, end_scale.z)) < 0.000001f)
+	{
+		return end;
+	}
+
+	glm::quat start_rotation = glm::quat_cast(glm::mat3(glm::vec3(start[0]) / start_scale.x, glm::vec3(start[1]) / start_scale.y, glm::vec3(start[2]) / start_scale.z));
+	glm::quat end_rotation = glm::quat_cast(glm::mat3(glm::vec3(end[0]) / end_scale.x, glm::vec3(end[1]) / end_scale.y, glm::vec3(end[2]) / end_scale.z));
+
+	glm::mat4 result = glm::mat4_cast(glm::slerp(start_rotation, end_rotation, f)) * glm::scale(glm::mat4(1.f), glm::mix(start_scale, end_scale, f));
+	result[3] = glm::mix(start[3], end[3], f);
+	return result;
+}
+
+glm::mat3 normalMatrix(const glm::mat4& transform)
+{ //Normals are renormalized in the shader, so a uniformly scaled rotation can be used as is and the inverse is only needed for non uniform scale
+	glm::mat3 upper = glm::mat3(transform);
+	float x = glm::dot(upper[0], upper[0]), y = glm::dot(upper[1], upper[1]), z = glm::dot(upper[2], upper[2]);
+	float tolerance = 0.0001f * std::max(x, std::max(y, z));
+	if (std::abs(x - y) <= tolerance && std::abs(x - z) <= tolerance && std::abs(glm::dot(upper[0], upper[1])) <= tolerance
+		&& std::abs(glm::dot(upper[0], upper[2])) <= tolerance && std::abs(glm::dot(upper[1], upper[2])) <= tolerance)
+	{
+		return upper;
+	}
+	return glm::transpose(glm::inverse(upper));
+}
 
 class Model
 {
@@ -14,12 +46,17 @@ private:
 	//Variables
 	std::vector<Model_Texture> textures_loaded;
 	std::vector<Mesh> meshes;
+	std::string path;
 	std::string directory;
 	bool gammaCorrection;
-	std::vector<glm::mat4> instanceMatrices;
+	std::vector<Orbit_Instance> instances;
 
 	glm::mat4 model = glm::mat4(1.f);
+	glm::mat4 prev_model = glm::mat4(1.f); //Model matrix from the previous simulation step
+	glm::mat4 render_model = glm::mat4(1.f);
+	glm::mat3 render_normal = glm::mat3(1.f); //Normal matrix of render_model
 	glm::vec3 origin = glm::vec3(0.f, 0.f, 0.f);
+	float bounding_radius = 0.f; //Around the model origin, before the model transform
 
 	//Functions
 	void loadModel(std::string const &model_path)
@@ -33,6 +70,7 @@ private:
 			return;
 		}
 
+		path = model_path;
 		directory = model_path.substr(0, model_path.find_last_of('/'));
 		processNode(scene->mRootNode, scene);
 	}
@@ -57,62 +95,10 @@ private:
 		std::vector<unsigned int> indices;
 		std::vector<Model_Texture> textures;
 
-		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
-		{
-			Vertex vertex;
-			glm::vec3 vector;
-
-			//positions
-			vector.x = mesh->mVertices[i].x;
-			vector.y = mesh->mVertices[i].y;
-			vector.z = mesh->mVertices[i].z;
-			vertex.position = vector;
-
-			//normals
-			if (mesh->HasNormals())
-			{
-				vector.x = mesh->mNormals[i].x;
-				vector.y = mesh->mNormals[i].y;
-				vector.z = mesh->mNormals[i].z;
-				vertex.normal = vector;
-			}
-
-			if (mesh->mTextureCoords[0])
-			{
-				glm::vec2 vec;
-
-				vec.x = mesh->mTextureCoords[0][i].x;
-				vec.y = mesh->mTextureCoords[0][i].y;
-				vertex.tex_coords = vec;
-
-				//tangents
-				vector.x = mesh->mTangents[i].x;
-				vector.y = mesh->mTangents[i].y;
-				vector.z = mesh->mTangents[i].z;
-				vertex.tangent = vector;
-
-				//bitangent
-				vector.x = mesh->mBitangents[i].x;
-				vector.y = mesh->mBitangents[i].y;
-				vector.z = mesh->mBitangents[i].z;
-				vertex.bitangents = vector;
-			}
-			else
-			{
-				vertex.tex_coords = glm::vec2(0.f, 0.f);
-			}
-			vertices.push_back(vertex);
-		}
-
-		//Get corresponding vertex indices from mesh's face.
-		for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+		convertMesh(mesh, vertices, indices);
+		for (const Vertex& vertex : vertices)
 		{
-			aiFace face = mesh->mFaces[i];
-
-			for (unsigned int j = 0; j < face.mNumIndices; j++)
-			{
-				indices.push_back(face.mIndices[j]);
-			}
+			bounding_radius = std::max(bounding_radius, glm::length(vertex.position));
 		}
 
 		aiMaterial* material = scene->mMaterials[mesh->mMaterialIndex];
@@ -140,8 +126,12 @@ private:
 			textures.insert(textures.end(), emissionMaps.begin(), emissionMaps.end());
 		}
 
+		//Opacity from the material's d value, see-through meshes are drawn in the transparency pass
+		float opacity = 1.f;
+		material->Get(AI_MATKEY_OPACITY, opacity);
+
 		//Return a mesh object created from the extracted mesh data.
-		return Mesh(vertices, indices, textures, instanceMatrices);
+		return Mesh(vertices, indices, textures, instances, path + " Mesh " + std::to_string(meshes.size()), opacity);
 	}
 
 	std::vector<Model_Texture> loadMaterialTextures(aiMaterial* mat, aiTextureType type, std::string typeName)
@@ -166,7 +156,7 @@ private:
 			if (!skip)
 			{
 				Model_Texture texture;
-				texture.id = TextureFromFile(str.C_Str(), this->directory);
+				texture.id = TextureFromFile(str.C_Str(), this->directory, typeName);
 				texture.type = typeName;
 				texture.path = str.C_Str();
 
@@ -177,16 +167,81 @@ private:
 		return textures;
 	}
 public:
-	Model(std::string const& path, std::vector<glm::mat4> instances = {}, bool gamma = false) : instanceMatrices(instances), gammaCorrection(gamma)
+	//Converts assimp's vertex and face data into the Mesh layout. Needs no GL state.
+	static void convertMesh(const aiMesh* mesh, std::vector<Vertex>& vertices, std::vector<unsigned int>& indices)
+	{
+		vertices.reserve(vertices.size() + mesh->mNumVertices);
+		indices.reserve(indices.size() + mesh->mNumFaces * 3);
+
+		for (unsigned int i = 0; i < mesh->mNumVertices; i++)
+		{
+			Vertex vertex;
+			glm::vec3 vector;
+
+			//positions
+			vector.x = mesh->mVertices[i].x;
+			vector.y = mesh->mVertices[i].y;
+			vector.z = mesh->mVertices[i].z;
+			vertex.position = vector;
+
+			//normals
+			if (mesh->HasNormals())
+			{
+				vector.x = mesh->mNormals[i].x;
+				vector.y = mesh->mNormals[i].y;
+				vector.z = mesh->mNormals[i].z;
+				vertex.normal = vector;
+			}
+
+			if (mesh->mTextureCoords[0])
+			{
+				glm::vec2 vec;
+
+				vec.x = mesh->mTextureCoords[0][i].x;
+				vec.y = mesh->mTextureCoords[0][i].y;
+				vertex.tex_coords = vec;
+
+				//tangents
+				vector.x = mesh->mTangents[i].x;
+				vector.y = mesh->mTangents[i].y;
+				vector.z = mesh->mTangents[i].z;
+				vertex.tangent = vector;
+
+				//bitangent
+				vector.x = mesh->mBitangents[i].x;
+				vector.y = mesh->mBitangents[i].y;
+				vector.z = mesh->mBitangents[i].z;
+				vertex.bitangents = vector;
+			}
+			else
+			{
+				vertex.tex_coords = glm::vec2(0.f, 0.f);
+			}
+			vertices.push_back(vertex);
+		}
+
+		//Get corresponding vertex indices from mesh's face.
+		for (unsigned int i = 0; i < mesh->mNumFaces; i++)
+		{
+			const aiFace& face = mesh->mFaces[i];
+
+			for (unsigned int j = 0; j < face.mNumIndices; j++)
+			{
+				indices.push_back(face.mIndices[j]);
+			}
+		}
+	}
+
+	Model(std::string const& path, std::vector<Orbit_Instance> instances = {}, bool gamma = false) : instances(instances), gammaCorrection(gamma)
 	{
 		if (instances.size() == 0)
 		{
 			model = glm::translate(glm::mat4(1.0f), origin);
 			model *= glm::rotate(glm::mat4(1.0f), 0.0f, glm::vec3(0.0f, 1.0f, 0.0f));
-			instanceMatrices.push_back(model);
 		}
 
 		loadModel(path);
+		std::vector<Orbit_Instance>().swap(this->instances); //Uploaded by the meshes, no need to keep a CPU copy
 	}
 
 	void Render(Shader &shader)
@@ -196,77 +251,125 @@ public:
 			meshes[i].Render(shader);
 		}
 	}
-	void RenderOutline()
+
+	//Each mesh draws with the variant its textures call for. draw_setup sets the per draw uniforms whenever that switches program.
+	//With TRANSPARENT in features only the see-through meshes are drawn, without it only the opaque ones.
+	//Instanced meshes draw only the given ranges of instances, or all of them without any.
+	void Render(ShaderVariants& variants, unsigned int features, const ShaderVariants::Setup& draw_setup, const std::vector<Instance_Range>* ranges = NULL)
 	{
+		if (ranges && ranges->empty()) { return; }
+		Shader* bound = NULL;
 		for (unsigned int i = 0; i < meshes.size(); i++)
 		{
-			meshes[i].RenderOutline();
+			if (meshes[i].isTransparent() != ((features & ShaderVariants::TRANSPARENT) != 0)) { continue; }
+			unsigned int mesh_features = meshes[i].getFeatures(features);
+			Shader* shader = variants.Use(mesh_features);
+			if (shader != bound)
+			{
+				draw_setup(*shader, mesh_features);
+				bound = shader;
+			}
+			meshes[i].Render(*shader, mesh_features, ranges);
+		}
+	}
+	//Opaque meshes only, see-through ones neither hide what is behind them nor cast shadows
+	void RenderDepth(const std::vector<Instance_Range>* ranges = NULL)
+	{
+		for (unsigned int i = 0; i < meshes.size(); i++)
+		{
+			if (meshes[i].isTransparent()) { continue; }
+			meshes[i].RenderDepth(ranges);
 		}
 	}
 
+	unsigned long long getVertexCount()
+	{
+		unsigned long long count = 0;
+		for (Mesh& mesh : meshes) { count += mesh.getVertexCount(); }
+		return count;
+	}
+
+	unsigned long long getIndexCount()
+	{
+		unsigned long long count = 0;
+		for (Mesh& mesh : meshes) { count += mesh.getIndexCount(); }
+		return count;
+	}
+
+	//Diameter in pixels the model covers this frame, its textures are streamed to match
+	void setScreenSize(float pixels)
+	{
+		for (Model_Texture& texture : textures_loaded) { texture_streamer.setScreenSize(texture.id, pixels); }
+	}
+
 
 	void Update(glm::mat4 model_transform)
 	{
+		prev_model = model;
 		model = model_transform;
 		//std::cout << glm::to_string(model) << std::endl;
 	}
 
+	void Interpolate(float alpha)
+	{
+		render_model = interpolateTransform(prev_model, model, alpha);
+		render_normal = normalMatrix(render_model);
+	}
+
 	glm::mat4 getModel()
 	{
 		return model;
 	}
 
+	glm::mat4 getRenderModel()
+	{
+		return render_model;
+	}
+
+	glm::mat3 getRenderNormalMatrix()
+	{
+		return render_normal;
+	}
+
 	glm::vec3 getPosition()
 	{
 		return model[3];
 	}
 
+	glm::vec3 getRenderPosition()
+	{
+		return render_model[3];
+	}
+
+	//Bounding sphere radius in world space, scaled by the largest axis of the interpolated transform
+	float getRenderBoundingRadius()
+	{
+		float scale = std::max(glm::length(glm::vec3(render_model[0])), std::max(glm::length(glm::vec3(render_model[1])), glm::length(glm::vec3(render_model[2]))));
+		return bounding_radius * scale;
+	}
+
 	void setPosition(glm::vec3 position)
 	{
 		model = glm::translate(glm::mat4(1.0f), position);
+		prev_model = render_model = model;
 	}
 
 	void setScale(glm::vec3 scale)
 	{
 		model *= glm::scale(scale);
+		prev_model = render_model = model;
 	}
 };
 
-unsigned int TextureFromFile(const char* texture_path, const std::string &directory, bool gamma)
-{
+unsigned int TextureFromFile(const char* texture_path, const std::string &directory, const std::string& type_name, bool gamma)
+{ //Streamed in the background, the texture shows a placeholder until its levels arrive
 	std::string file_name = std::string(texture_path);
 	file_name = directory + '/' + file_name;
 
-	unsigned int texture_id;
-	glGenTextures(1, &texture_id);
-
-	//stbi_set_flip_vertically_on_load(true);
-
-	int width, height, nrComponents;
-	unsigned char *data = stbi_load(file_name.c_str(), &width, &height, &nrComponents, 0);
-	if (data)
-	{
-		GLenum format;
-		if (nrComponents == 1) { format = GL_RED; }
-		else if (nrComponents == 3) { format = GL_RGB; }
-		else if (nrComponents == 4) { format = GL_RGBA; }
-
-		glBindTexture(GL_TEXTURE_2D, texture_id);
-		glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-		glGenerateMipmap(GL_TEXTURE_2D);
-
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	TextureStreamer::Placeholder placeholder = TextureStreamer::GREY;
+	if (type_name == "texture_normal") { placeholder = TextureStreamer::FLAT_NORMAL; }
+	else if (type_name == "texture_specular" || type_name == "texture_emission") { placeholder = TextureStreamer::BLACK; }
 
-		stbi_image_free(data);
-	}
-	else
-	{
-		std::cout << "Texture failed to load at path: " << texture_path << std::endl;
-		stbi_image_free(data);
-	}
-	return texture_id;
+	return texture_streamer.Load2D(file_name, false, placeholder);
 }
 #endif
\ No newline at end of file
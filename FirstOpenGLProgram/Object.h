@@ -4,20 +4,14 @@
 
 #include "Main_Header.h"
 #include "Texture.h"
+#include "Render_Stats.h"
+#include "Debug_Output.h"
+#include "Memory_Tracker.h"
+#include "Object_Geometry.h"
 
-class Object
+class Object : public ObjectGeometry
 {
 public:
-	struct Vertex
-	{
-		glm::vec3 vertex;
-		glm::vec3 normal;
-		glm::vec2 texture_coords;
-	};
-
-	std::vector<unsigned int> Indices;
-	std::vector<Vertex> Vertices;
-
 	GLuint VB;
 	GLuint IB;
 	GLuint VAO;
@@ -40,10 +34,18 @@ public:
 		//Vertex VBO
 		glBindBuffer(GL_ARRAY_BUFFER, VB);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * Vertices.size(), &Vertices[0], GL_STATIC_DRAW);
+		render_stats.CountBufferUpload(sizeof(Vertex) * Vertices.size());
 
 		//Index VBO
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IB);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * Indices.size(), &Indices[0], GL_STATIC_DRAW);
+		render_stats.CountBufferUpload(sizeof(unsigned int) * Indices.size());
+		memory_tracker.Allocate(GL_BUFFER, VB, MemoryTracker::VERTEX_BUFFER, object_file_path, sizeof(Vertex) * Vertices.size());
+		memory_tracker.Allocate(GL_BUFFER, IB, MemoryTracker::INDEX_BUFFER, object_file_path, sizeof(unsigned int) * Indices.size());
+
+		debug_output.Label(GL_VERTEX_ARRAY, VAO, std::string(object_file_path) + " VAO");
+		debug_output.Label(GL_BUFFER, VB, std::string(object_file_path) + " Vertices");
+		debug_output.Label(GL_BUFFER, IB, std::string(object_file_path) + " Indices");
 
 		glEnableVertexAttribArray(0);
 		glEnableVertexAttribArray(1);
@@ -67,56 +69,14 @@ public:
 	void Render(Shader &shader)
 	{
 		glBindVertexArray(VAO);
-		glUniform1i(shader.GetUniformLocation("material.texture_diffuse1"), 0);
+		render_stats.CountVertexArray();
+		uploadUniform(glUniform1i, shader.GetUniformLocation("material.texture_diffuse1"), 0);
 		m_texture->bindTextures();
 		glDrawElements(GL_TRIANGLES, Indices.size(), GL_UNSIGNED_INT, 0);
+		render_stats.CountDraw(Indices.size() / 3);
 		glBindVertexArray(0);
 	}
 
-	void loadModel(const char* file_path)
-	{
-		std::ifstream object_file(file_path);
-
-		if (object_file.is_open())
-		{
-			std::string line;
-
-			while (getline(object_file, line))
-			{
-				std::stringstream sstream(line);
-				std::string type;
-				sstream >> type;
-
-				if (type == "V")
-				{
-					Vertex m_vertex;
-					sstream >> m_vertex.vertex.x >> m_vertex.vertex.y >> m_vertex.vertex.z
-						>> m_vertex.normal.x >> m_vertex.normal.y >> m_vertex.normal.z
-						>> m_vertex.texture_coords.x >> m_vertex.texture_coords.y;
-					Vertices.push_back(m_vertex);
-				}
-				else if (type == "I")
-				{
-					std::string index;
-					while (sstream >> index)
-					{
-						Indices.push_back((unsigned int)std::stoi(index));
-					}
-				}
-			}
-			object_file.close();
-		}
-		else
-		{
-			std::cerr << "Error: Could not Open File!\n" << std::endl;
-		}
-
-		for (unsigned int i = 0; i < Indices.size(); i++)
-		{
-			Indices[i] = Indices[i] - 1;
-		}
-	}
-
 	void Update(glm::mat4 model_transform)
 	{
 		model = model_transform;
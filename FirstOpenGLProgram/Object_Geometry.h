@@ -0,0 +1,102 @@
+#pragma once
+#ifndef OBJECT_GEOMETRY_H
+#define OBJECT_GEOMETRY_H
+
+#include "Core_Header.h"
+
+//Vertices and indices of an Object, built on the CPU. Object uploads them, this part needs no GL context.
+class ObjectGeometry
+{
+public:
+	struct Vertex
+	{
+		glm::vec3 vertex;
+		glm::vec3 normal;
+		glm::vec2 texture_coords;
+	};
+
+	std::vector<unsigned int> Indices;
+	std::vector<Vertex> Vertices;
+
+	void loadModel(const char* file_path)
+	{
+		std::ifstream object_file(file_path);
+
+		if (object_file.is_open())
+		{
+			std::string line;
+
+			while (getline(object_file, line))
+			{
+				std::stringstream sstream(line);
+				std::string type;
+				sstream >> type;
+
+				if (type == "V")
+				{
+					Vertex m_vertex;
+					sstream >> m_vertex.vertex.x >> m_vertex.vertex.y >> m_vertex.vertex.z
+						>> m_vertex.normal.x >> m_vertex.normal.y >> m_vertex.normal.z
+						>> m_vertex.texture_coords.x >> m_vertex.texture_coords.y;
+					Vertices.push_back(m_vertex);
+				}
+				else if (type == "I")
+				{
+					std::string index;
+					while (sstream >> index)
+					{
+						Indices.push_back((unsigned int)std::stoi(index));
+					}
+				}
+			}
+			object_file.close();
+		}
+		else
+		{
+			std::cerr << "Error: Could not Open File!\n" << std::endl;
+		}
+
+		for (unsigned int i = 0; i < Indices.size(); i++)
+		{
+			Indices[i] = Indices[i] - 1;
+		}
+	}
+
+	//Unit sphere, precision slices around and stacks from pole to pole
+	void generateSphere(int precision)
+	{
+		int num_vertices = (precision + 1) * (precision + 1);
+		int num_indices = precision * precision * 6;
+
+		Vertices.assign(num_vertices, Vertex());
+		Indices.assign(num_indices, 0);
+
+		for (int i = 0; i <= precision; i++) //Compute Vertices
+		{
+			for (int j = 0; j <= precision; j++)
+			{
+				float y = (float)cos(glm::radians(180.f - i * 180.f / precision));
+				float x = -(float)cos(glm::radians(j * 360.f / precision)) * (float)abs(cos(asin(y)));
+				float z = (float)sin(glm::radians(j * 360.f / precision)) * (float)abs(cos(asin(y)));
+				Vertices[i * (precision + 1) + j].vertex = glm::vec3(x, y, z);
+				Vertices[i * (precision + 1) + j].normal = glm::vec3(x, y, z);
+				Vertices[i * (precision + 1) + j].texture_coords = glm::vec2(((float)j / precision), ((float)i / precision));
+			}
+		}
+
+		for (int i = 0; i < precision; i++) //Compute Indices
+		{
+			for (int j = 0; j < precision; j++)
+			{
+				Indices[6 * (i * precision + j) + 0] = i * (precision + 1) + j;
+				Indices[6 * (i * precision + j) + 1] = i * (precision + 1) + j + 1;
+				Indices[6 * (i * precision + j) + 2] = (i + 1) * (precision + 1) + j;
+				Indices[6 * (i * precision + j) + 3] = i * (precision + 1) + j + 1;
+				Indices[6 * (i * precision + j) + 4] = (i + 1) * (precision + 1) + j + 1;
+				Indices[6 * (i * precision + j) + 5] = (i + 1) * (precision + 1) + j;
+			}
+		}
+	}
+};
+
+#endif
@@ -0,0 +1,25 @@
+#pragma once
+#ifndef ORBIT_INSTANCE_H
+#define ORBIT_INSTANCE_H
+
+#include "Core_Header.h"
+
+struct Orbit_Instance
+{ //Orbital elements of one instanced copy, the vertex shader rebuilds its model matrix from these every frame
+	float radius;
+	float phase;
+	float angular_speed;
+	float height;
+	float tilt;
+	float scale;
+	float spin_speed;
+	float spin_phase;
+};
+
+struct Instance_Range
+{ //Consecutive instances drawn together, culling draws an instanced mesh as a few of these
+	unsigned int first;
+	unsigned int count;
+};
+
+#endif
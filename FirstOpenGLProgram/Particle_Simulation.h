@@ -0,0 +1,236 @@
+#pragma once
+#ifndef PARTICLE_SIMULATION_H
+#define PARTICLE_SIMULATION_H
+
+#include "Core_Header.h"
+
+//The CPU side of an emitter, spawning, moving and sorting particles. Emitter adds the buffers and draw on top.
+class ParticleSimulation
+{
+public:
+	enum Blending
+	{
+		WEIGHTED, //Order independent, blended through the weighted transparency targets
+		ADDITIVE, //Adds light like a flame, order independent as well
+		SORTED //True alpha blending, drawn back to front after the transparency targets are resolved, so always over them
+	};
+
+protected:
+	static const uint32_t DEAD_KEY = 0xFFFFFFFF; //Sorts after every live particle
+
+	struct Particle
+	{
+		glm::vec3 position, velocity; //World space in both modes, local space only drags live particles along with the origin
+		glm::vec4 color;
+		float life;
+
+		Particle() : position(0.f), velocity(0.f), color(1.f), life(0.f) { }
+	};
+	std::vector<Particle> particles;
+
+	//Particle settings
+	unsigned int particle_total;
+	unsigned int spawn_amount;
+	float particle_range;
+	float particle_life;
+
+	unsigned int last_used_particle = 0;
+	unsigned int spawn_rate;
+	float spawn_accumulator;
+	glm::vec3 particle_velocity;
+	glm::vec3 prev_origin;
+	std::minstd_rand generator; //Per emitter so emitters can update on different threads
+
+	bool local_space = true;
+	Blending blending = WEIGHTED;
+
+	//Back to front order of the particle slots for SORTED emitters, kept between frames as the starting point of the next sort
+	std::vector<unsigned int> draw_order;
+	std::vector<uint64_t> sort_entries; //Depth key in the high half, slot in the low half
+	std::vector<uint64_t> sort_scratch;
+	bool last_sort_incremental = false;
+
+	//Float bits reordered so unsigned comparison matches float comparison, then inverted so the farthest particle comes first
+	static uint32_t depthKey(float depth)
+	{
+		uint32_t bits;
+		memcpy(&bits, &depth, sizeof(bits));
+		bits = (bits & 0x80000000u) ? ~bits : bits | 0x80000000u;
+		return ~bits;
+	}
+
+public:
+	void useWorldSpace() { local_space = false; }
+	void useLocalSpace() { local_space = true; }
+	void setBlending(Blending mode) { blending = mode; }
+	Blending getBlending() { return blending; }
+
+	//Particle settings and storage only, no GL calls, so the simulation can run without a context.
+	void Configure(unsigned int total_spawned, unsigned int spawn_amount, unsigned int rate, float range, float life, unsigned int seed)
+	{
+		particle_total = total_spawned;
+		this->spawn_amount = spawn_amount;
+		spawn_rate = rate;
+		particle_range = range;
+		particle_life = life;
+		spawn_accumulator = 0.f;
+		last_used_particle = 0;
+		prev_origin = glm::vec3(0.f);
+		generator.seed(seed);
+
+		particles.assign(particle_total, Particle());
+
+		draw_order.resize(particle_total);
+		for (unsigned int i = 0; i < particle_total; i++) { draw_order[i] = i; }
+	}
+
+	//Insertion sort that gives up after max_moves element moves, returns whether the entries ended up sorted.
+	//Close to linear on nearly sorted input, entries stay a valid permutation either way.
+	static bool InsertionSort(std::vector<uint64_t>& entries, size_t max_moves)
+	{
+		size_t moves = 0;
+		for (size_t i = 1; i < entries.size(); i++)
+		{
+			uint64_t entry = entries[i];
+			size_t j = i;
+			while (j > 0 && entries[j - 1] > entry && moves < max_moves)
+			{
+				entries[j] = entries[j - 1];
+				j--;
+				moves++;
+			}
+			entries[j] = entry;
+			if (moves >= max_moves) { return false; }
+		}
+		return true;
+	}
+
+	//Least significant digit radix sort on the 32 bit key in the high half, 8 bits per pass. Passes over a digit that
+	//every key shares are skipped, which is common since nearby depths share their exponent.
+	static void RadixSort(std::vector<uint64_t>& entries, std::vector<uint64_t>& scratch)
+	{
+		if (entries.empty()) { return; }
+		scratch.resize(entries.size());
+		for (int shift = 32; shift < 64; shift += 8)
+		{
+			size_t counts[256] = {};
+			for (uint64_t entry : entries) { counts[(entry >> shift) & 0xFF]++; }
+			if (counts[(entries[0] >> shift) & 0xFF] == entries.size()) { continue; }
+
+			size_t offset = 0;
+			for (int digit = 0; digit < 256; digit++)
+			{
+				size_t count = counts[digit];
+				counts[digit] = offset;
+				offset += count;
+			}
+			for (uint64_t entry : entries) { scratch[counts[(entry >> shift) & 0xFF]++] = entry; }
+			entries.swap(scratch);
+		}
+	}
+
+	//Orders the particles far to near along the view direction, for SORTED emitters. No GL calls, runs on a worker.
+	//Particles move little between frames, so last frame's order is nearly sorted and an insertion sort finishes in about
+	//linear time. A camera cut or fast turn shuffles the order, then the radix sort takes over.
+	//view must be the matrix Render draws with, positions are already in world space so there is no model transform.
+	void SortParticles(const glm::mat4& view)
+	{
+		glm::vec4 depth_axis = -glm::vec4(view[0][2], view[1][2], view[2][2], view[3][2]); //Row of the view matrix giving -z
+		sort_entries.resize(draw_order.size());
+		for (unsigned int i = 0; i < draw_order.size(); i++)
+		{
+			unsigned int slot = draw_order[i];
+			const Particle& particle = particles[slot];
+			uint32_t key = particle.life > 0.f ? depthKey(glm::dot(depth_axis, glm::vec4(particle.position, 1.f))) : DEAD_KEY;
+			sort_entries[i] = (uint64_t)key << 32 | slot;
+		}
+
+		last_sort_incremental = InsertionSort(sort_entries, sort_entries.size());
+		if (!last_sort_incremental) { RadixSort(sort_entries, sort_scratch); }
+
+		for (unsigned int i = 0; i < draw_order.size(); i++) { draw_order[i] = (unsigned int)sort_entries[i]; }
+	}
+
+	//Whether the last sort got away with the insertion sort
+	bool wasSortIncremental()
+	{
+		return last_sort_incremental;
+	}
+
+	unsigned int firstUnusedParticle()
+	{
+		for (unsigned int i = last_used_particle; i < particle_total; i++) //First attempt to find, usually works
+		{
+			if (particles[i].life <= 0.f)
+			{
+				last_used_particle = i;
+				return i;
+			}
+		}
+
+		//Linear Search
+		for (unsigned int i = 0; i < particle_total; i++)
+		{
+			if (particles[i].life <= 0.f)
+			{
+				last_used_particle = i;
+				return i;
+			}
+		}
+
+		last_used_particle = 0;
+		return 0;
+	}
+
+	glm::vec3 sphericalOffset(float radius)
+	{
+		std::uniform_real_distribution<float> distribution(0.f, 1.f);
+		float z = distribution(generator) * 2.f - 1.f;
+		float theta = distribution(generator) * glm::two_pi<float>();
+		float ring_radius = sqrt(1.f - z * z);
+		return glm::vec3(ring_radius * cos(theta), ring_radius * sin(theta), z) * radius;
+	}
+
+	void respawnParticle(Particle &particle, glm::vec3 particle_origin, glm::vec3 particle_velocity)
+	{
+		glm::vec3 offset = sphericalOffset(particle_range);
+		particle.position = particle_origin + offset;
+		particle.life = particle_life;
+		particle.velocity = particle_velocity;
+		particle.color = glm::vec4(1.0f);
+	}
+
+	void emitParticles(double dt, glm::vec3 origin, glm::vec3 velocity)
+	{
+		glm::vec3 object_movement = origin - prev_origin;
+		prev_origin = origin;
+
+		spawn_accumulator += spawn_rate * dt;
+
+		if (spawn_accumulator > 1)
+		{
+			spawn_accumulator = 0;
+			for (unsigned int i = 0; i < spawn_amount; i++) //Emit new particles
+			{
+				int unused_particle = firstUnusedParticle();
+				respawnParticle(particles[unused_particle], origin, velocity);
+			}
+		}
+
+		for (unsigned int i = 0; i < particle_total; i++) //Update particles
+		{
+			Particle& part = particles[i];
+			part.life -= dt;
+
+			if (part.life > 0.f)
+			{
+				//part.position -= part.velocity * dt;
+				if (local_space) { part.position += object_movement; }
+				part.position += part.velocity * dt;
+				part.color.a = part.life / particle_life;
+			}
+		}
+	}
+};
+
+#endif
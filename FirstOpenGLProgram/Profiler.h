@@ -0,0 +1,297 @@
+#pragma once
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include "Main_Header.h"
+#include "Debug_Output.h"
+#include "Render_Stats.h"
+
+class Profiler
+{
+public:
+	struct Stats
+	{
+		double min = 0.0;
+		double avg = 0.0;
+		double p99 = 0.0;
+		unsigned int samples = 0;
+	};
+
+private:
+	//Timestamp queries are read back a few frames later and only once available, so they never stall the pipeline
+	static const unsigned int FRAMES_IN_FLIGHT = 3;
+	static const unsigned int HISTORY_SIZE = 240; //Rolling window used for min/avg/p99
+
+	struct Marker
+	{
+		std::string name;
+		unsigned int depth;
+		double cpu_start, cpu_end; //Microseconds since the profiler started
+		int gpu_query = -1; //Index of the start query, the end query follows it
+		bool debug_group = false;
+	};
+
+	struct Frame
+	{
+		std::vector<Marker> markers;
+		std::vector<GLuint> queries;
+		unsigned int queries_used = 0;
+	};
+
+	struct History
+	{
+		std::vector<double> cpu, gpu; //Milliseconds
+		unsigned int cpu_next = 0, gpu_next = 0;
+		unsigned long long gpu_count = 0; //GPU samples resolved so far, tells a new sample from one already seen
+	};
+
+	struct TraceEvent
+	{
+		std::string name;
+		bool gpu;
+		double start, duration; //Microseconds
+	};
+
+	Frame frames[FRAMES_IN_FLIGHT];
+	unsigned int frame_index = 0;
+	std::vector<unsigned int> open_markers;
+	std::map<std::string, History> history;
+	std::vector<std::string> marker_order; //First-seen order keeps the report readable
+
+	std::chrono::steady_clock::time_point start_time = std::chrono::steady_clock::now();
+	double gpu_clock_offset = 0.0; //GPU timestamps are in their own clock, this moves them onto the CPU timeline
+	bool gpu_timing = false;
+
+	bool capturing = false;
+	std::vector<TraceEvent> trace_events;
+
+	double cpuNow()
+	{
+		return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start_time).count();
+	}
+
+	void addSample(std::vector<double>& samples, unsigned int& next, double value)
+	{
+		if (samples.size() < HISTORY_SIZE) { samples.push_back(value); }
+		else { samples[next] = value; }
+		next = (next + 1) % HISTORY_SIZE;
+	}
+
+	Stats computeStats(std::vector<double> samples)
+	{
+		Stats stats;
+		if (samples.empty()) { return stats; }
+
+		std::sort(samples.begin(), samples.end());
+		double total = 0.0;
+		for (double sample : samples) { total += sample; }
+
+		stats.min = samples.front();
+		stats.avg = total / samples.size();
+		stats.p99 = samples[std::min(samples.size() - 1, (size_t)(samples.size() * 0.99))];
+		stats.samples = samples.size();
+		return stats;
+	}
+
+	void collectFrame(Frame& frame)
+	{
+		for (Marker& marker : frame.markers)
+		{
+			History& marker_history = history[marker.name];
+			if (marker_history.cpu.empty() && marker_history.gpu.empty()) { marker_order.push_back(marker.name); }
+
+			addSample(marker_history.cpu, marker_history.cpu_next, (marker.cpu_end - marker.cpu_start) / 1000.0);
+			if (capturing) { trace_events.push_back({ marker.name, false, marker.cpu_start, marker.cpu_end - marker.cpu_start }); }
+
+			if (marker.gpu_query < 0) { continue; }
+
+			GLuint available = 0;
+			glGetQueryObjectuiv(frame.queries[marker.gpu_query + 1], GL_QUERY_RESULT_AVAILABLE, &available);
+			if (!available) { continue; } //Dropping a late sample is better than waiting on the GPU
+
+			GLuint64 gpu_start, gpu_end;
+			glGetQueryObjectui64v(frame.queries[marker.gpu_query], GL_QUERY_RESULT, &gpu_start);
+			glGetQueryObjectui64v(frame.queries[marker.gpu_query + 1], GL_QUERY_RESULT, &gpu_end);
+
+			addSample(marker_history.gpu, marker_history.gpu_next, (gpu_end - gpu_start) / 1000000.0);
+			marker_history.gpu_count++;
+			if (capturing) { trace_events.push_back({ marker.name, true, gpu_start / 1000.0 - gpu_clock_offset, (gpu_end - gpu_start) / 1000.0 }); }
+		}
+
+		frame.markers.clear();
+		frame.queries_used = 0;
+	}
+
+public:
+	void Initialize()
+	{
+		//Line the GPU clock up with the CPU clock once, the trace only needs them roughly aligned
+		GLint64 gpu_time = 0;
+		glGetInteger64v(GL_TIMESTAMP, &gpu_time);
+		gpu_clock_offset = gpu_time / 1000.0 - cpuNow();
+		gpu_timing = true;
+	}
+
+	void BeginFrame()
+	{
+		frame_index = (frame_index + 1) % FRAMES_IN_FLIGHT;
+		collectFrame(frames[frame_index]); //Oldest frame, recorded FRAMES_IN_FLIGHT - 1 frames ago
+		open_markers.clear();
+	}
+
+	void BeginMarker(const std::string& name, bool gpu = true)
+	{
+		Frame& frame = frames[frame_index];
+
+		Marker marker;
+		marker.name = name;
+		marker.depth = open_markers.size();
+		marker.cpu_start = cpuNow();
+
+		if (gpu)
+		{ //GPU markers are render passes, they also show up as debug groups in graphics debuggers and in the render stats
+			debug_output.PushGroup(name);
+			render_stats.BeginPass(name);
+			marker.debug_group = true;
+		}
+
+		if (gpu && gpu_timing)
+		{
+			if (frame.queries_used + 2 > frame.queries.size())
+			{
+				frame.queries.resize(frame.queries_used + 2);
+				glGenQueries(2, &frame.queries[frame.queries_used]);
+			}
+			marker.gpu_query = frame.queries_used;
+			glQueryCounter(frame.queries[frame.queries_used], GL_TIMESTAMP);
+			frame.queries_used += 2;
+		}
+
+		open_markers.push_back(frame.markers.size());
+		frame.markers.push_back(marker);
+	}
+
+	void EndMarker()
+	{
+		if (open_markers.empty()) { return; }
+
+		Frame& frame = frames[frame_index];
+		Marker& marker = frame.markers[open_markers.back()];
+		open_markers.pop_back();
+
+		if (marker.gpu_query >= 0) { glQueryCounter(frame.queries[marker.gpu_query + 1], GL_TIMESTAMP); }
+		if (marker.debug_group)
+		{
+			render_stats.EndPass();
+			debug_output.PopGroup();
+		}
+		marker.cpu_end = cpuNow();
+	}
+
+	Stats getCpuStats(const std::string& name)
+	{
+		return computeStats(history[name].cpu);
+	}
+
+	Stats getGpuStats(const std::string& name)
+	{
+		return computeStats(history[name].gpu);
+	}
+
+	//Newest GPU time of a marker in milliseconds, a few frames old, or 0 before any timestamps came back
+	double getLatestGpuTime(const std::string& name)
+	{
+		auto marker_history = history.find(name);
+		if (marker_history == history.end() || marker_history->second.gpu.empty()) { return 0.0; }
+
+		const History& samples = marker_history->second;
+		return samples.gpu[(samples.gpu_next + samples.gpu.size() - 1) % samples.gpu.size()];
+	}
+
+	//GPU samples of a marker resolved so far, the latest time only changes when this does
+	unsigned long long getGpuSampleCount(const std::string& name)
+	{
+		auto marker_history = history.find(name);
+		return marker_history == history.end() ? 0 : marker_history->second.gpu_count;
+	}
+
+	void PrintReport(std::ostream& out)
+	{
+		out << "Profiler (ms over the last " << HISTORY_SIZE << " frames)" << std::endl;
+		out << "Marker                    CPU min / avg / p99         GPU min / avg / p99" << std::endl;
+
+		for (const std::string& name : marker_order)
+		{
+			Stats cpu = getCpuStats(name);
+			Stats gpu = getGpuStats(name);
+
+			char line[256];
+			snprintf(line, sizeof(line), "%-24s %7.3f / %7.3f / %7.3f", name.c_str(), cpu.min, cpu.avg, cpu.p99);
+			out << line;
+			if (gpu.samples > 0)
+			{
+				snprintf(line, sizeof(line), "   %7.3f / %7.3f / %7.3f", gpu.min, gpu.avg, gpu.p99);
+				out << line;
+			}
+			out << std::endl;
+		}
+	}
+
+	void StartCapture()
+	{
+		trace_events.clear();
+		capturing = true;
+	}
+
+	bool isCapturing()
+	{
+		return capturing;
+	}
+
+	bool StopCapture(const std::string& file_path)
+	{ //Writes Chrome trace-event JSON, open it in Perfetto or chrome://tracing
+		capturing = false;
+
+		std::ofstream trace_file(file_path);
+		if (!trace_file.is_open())
+		{
+			std::cerr << "Error: Could not Open File!\n" << file_path << std::endl;
+			return false;
+		}
+
+		trace_file << "{\"traceEvents\":[\n";
+		trace_file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+		trace_file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+		for (const TraceEvent& event : trace_events)
+		{
+			trace_file << ",\n{\"name\":\"" << event.name << "\",\"cat\":\"" << (event.gpu ? "gpu" : "cpu")
+				<< "\",\"ph\":\"X\",\"ts\":" << std::fixed << std::setprecision(3) << event.start << ",\"dur\":" << event.duration
+				<< ",\"pid\":1,\"tid\":" << (event.gpu ? 2 : 1) << "}";
+		}
+		trace_file << "\n]}\n";
+		trace_file.close();
+
+		std::cout << "Saved profiler trace to: " << file_path << std::endl;
+		trace_events.clear();
+		return true;
+	}
+};
+
+Profiler profiler;
+
+class ProfileScope
+{ //Marks the enclosing block, markers nest in the order scopes are opened.
+public:
+	ProfileScope(const std::string& name, bool gpu = true)
+	{
+		profiler.BeginMarker(name, gpu);
+	}
+
+	~ProfileScope()
+	{
+		profiler.EndMarker();
+	}
+};
+
+#endif
@@ -0,0 +1,104 @@
+#pragma once
+#ifndef RENDER_STATS_H
+#define RENDER_STATS_H
+
+#include "Main_Header.h"
+
+class RenderStats
+{
+public:
+	struct Counters
+	{
+		unsigned int draw_calls = 0;
+		unsigned int instances = 0; //Instanced draws count every instance
+		unsigned long long triangles = 0;
+		unsigned int program_binds = 0;
+		unsigned int vao_binds = 0;
+		unsigned int texture_binds = 0;
+		unsigned int framebuffer_binds = 0;
+		unsigned int uniform_uploads = 0;
+		unsigned long long buffer_bytes = 0;
+	};
+
+	struct Pass
+	{
+		std::string name;
+		Counters counters;
+	};
+
+private:
+	Counters frame;
+	std::vector<Pass> passes;
+	std::vector<unsigned int> open_passes; //Counts go to the innermost open pass only
+
+	//The last finished frame, stable while the next one is being counted
+	Counters last_frame;
+	std::vector<Pass> last_passes;
+
+	template <typename Function>
+	void count(Function add)
+	{
+		add(frame);
+		if (!open_passes.empty()) { add(passes[open_passes.back()].counters); }
+	}
+
+public:
+	void Reset()
+	{ //Call at the start of every frame
+		last_frame = frame;
+		last_passes = passes;
+
+		frame = Counters();
+		passes.clear();
+		open_passes.clear();
+	}
+
+	void BeginPass(const std::string& name)
+	{
+		open_passes.push_back(passes.size());
+		passes.push_back({ name, Counters() });
+	}
+
+	void EndPass()
+	{
+		if (!open_passes.empty()) { open_passes.pop_back(); }
+	}
+
+	void CountDraw(unsigned long long triangles, unsigned int instance_count = 1)
+	{
+		count([&](Counters& counters)
+		{
+			counters.draw_calls++;
+			counters.instances += instance_count;
+			counters.triangles += triangles * instance_count;
+		});
+	}
+
+	void CountProgram() { count([](Counters& counters) { counters.program_binds++; }); }
+	void CountVertexArray() { count([](Counters& counters) { counters.vao_binds++; }); }
+	void CountTexture() { count([](Counters& counters) { counters.texture_binds++; }); }
+	void CountFramebuffer() { count([](Counters& counters) { counters.framebuffer_binds++; }); }
+	void CountUniform() { count([](Counters& counters) { counters.uniform_uploads++; }); }
+	void CountBufferUpload(unsigned long long bytes) { count([bytes](Counters& counters) { counters.buffer_bytes += bytes; }); }
+
+	//Counts of the frame being rendered
+	const Counters& getFrame()
+	{
+		return frame;
+	}
+
+	//Counts of the last finished frame and its passes, in the order the passes began
+	const Counters& getLastFrame()
+	{
+		return last_frame;
+	}
+
+	const std::vector<Pass>& getLastPasses()
+	{
+		return last_passes;
+	}
+};
+
+RenderStats render_stats;
+
+#endif
@@ -3,6 +3,7 @@
 #define SHADER_H
 
 #include "Main_Header.h"
+#include "Render_Stats.h"
 
 class Shader
 {
@@ -75,12 +76,54 @@ public:
 		return true;
 	}
 
+	//Like AddShader but without waiting for the compiler, errors are reported by FinishLink
+	void CompileShader(GLenum shader_type, const GLchar* shader_source)
+	{
+		GLuint shader_object = glCreateShader(shader_type);
+		m_shaderObjList.push_back(shader_object);
+		glShaderSource(shader_object, 1, &shader_source, NULL);
+		glCompileShader(shader_object);
+		glAttachShader(m_shaderProg, shader_object);
+	}
+
 	bool Finalize()
+	{
+		StartLink();
+		return FinishLink();
+	}
+
+	void StartLink()
+	{
+		glProgramParameteri(m_shaderProg, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE); //Lets the shader cache read the linked binary back
+		glLinkProgram(m_shaderProg);
+	}
+
+	//With parallel shader compile the driver links in the background, this polls it without blocking
+	bool isLinkDone()
+	{
+		if (!GLEW_KHR_parallel_shader_compile) { return true; }
+
+		GLint done = GL_TRUE;
+		glGetProgramiv(m_shaderProg, GL_COMPLETION_STATUS_KHR, &done);
+		return done == GL_TRUE;
+	}
+
+	//Blocks until the link started by StartLink is finished, then checks every stage
+	bool FinishLink()
 	{
 		GLint compile_success;
 		GLchar infoLog[1024];
 
-		glLinkProgram(m_shaderProg);
+		for (GLuint shader : m_shaderObjList)
+		{
+			glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_success);
+			if (!compile_success)
+			{
+				glGetShaderInfoLog(shader, sizeof(infoLog), NULL, infoLog);
+				std::cerr << "Error: Shader Object Compilation Failed!\n" << infoLog << std::endl;
+				return false;
+			}
+		}
 
 		//Check if Shader Program Links
 		glGetProgramiv(m_shaderProg, GL_LINK_STATUS, &compile_success);
@@ -92,7 +135,8 @@ public:
 			return false;
 		}
 
-		//Check if Shader Program Validates
+#ifdef _DEBUG
+		//Check if Shader Program Validates, against whatever state is bound at startup so it only catches gross errors
 		glValidateProgram(m_shaderProg);
 		glGetProgramiv(m_shaderProg, GL_VALIDATE_STATUS, &compile_success);
 		if (!compile_success)
@@ -101,6 +145,7 @@ public:
 			std::cerr << "Error: Invalid Shader Program!\n" << infoLog << std::endl;
 			return false;
 		}
+#endif
 
 		for (GLuint shader : m_shaderObjList)
 		{
@@ -111,9 +156,33 @@ public:
 		return true;
 	}
 
+	//Links from a binary saved by GetBinary, false if the driver no longer accepts it
+	bool LoadBinary(GLenum format, const std::vector<char>& binary)
+	{
+		GLint link_success;
+		glProgramBinary(m_shaderProg, format, binary.data(), binary.size());
+		glGetProgramiv(m_shaderProg, GL_LINK_STATUS, &link_success);
+		return link_success == GL_TRUE;
+	}
+
+	bool GetBinary(uint32_t& format, std::vector<char>& binary)
+	{
+		GLint length = 0;
+		glGetProgramiv(m_shaderProg, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0) { return false; }
+
+		GLenum binary_format = 0;
+		binary.resize(length);
+		glGetProgramBinary(m_shaderProg, length, &length, &binary_format, binary.data());
+		binary.resize(length);
+		format = binary_format;
+		return length > 0;
+	}
+
 	void Enable()
 	{
 		glUseProgram(m_shaderProg);
+		render_stats.CountProgram();
 	}
 
 	GLuint getAttribuLocation(const char* attribute_name)
@@ -139,4 +208,13 @@ public:
 	}
 
 };
+
+//Sets a uniform through any glUniform* function and counts the upload. GL ignores location -1, so those are not counted.
+template <typename Upload, typename... Args>
+void uploadUniform(Upload upload, GLint location, Args... args)
+{
+	if (location == -1) { return; }
+	upload(location, args...);
+	render_stats.CountUniform();
+}
 #endif
@@ -0,0 +1,183 @@
+#pragma once
+#ifndef SHADER_CACHE_H
+#define SHADER_CACHE_H
+
+#include "Main_Header.h"
+#include "Shader.h"
+
+//Linked program binaries kept on disk between runs. Entries are keyed by a hash of the driver and the shader sources,
+//so editing a shader or updating the driver simply misses and falls back to compiling from source.
+class ShaderCache
+{
+private:
+	static const uint32_t FILE_MAGIC = 0x48534347;
+	static const uint32_t FILE_VERSION = 1;
+	static const uint64_t FNV_OFFSET = 14695981039346656037ULL;
+	static const uint64_t FNV_PRIME = 1099511628211ULL;
+
+	struct Entry
+	{
+		uint32_t format;
+		std::vector<char> binary;
+	};
+
+	std::string file_path;
+	std::string driver; //Vendor, renderer and version, binaries are only valid for the driver that produced them
+	bool enabled = false;
+	bool dirty = false;
+
+	std::map<uint64_t, Entry> stored; //Read from disk
+	std::map<uint64_t, Entry> used; //Written back, so binaries of edited shaders drop out of the file
+	unsigned int hits = 0, misses = 0;
+
+	uint64_t key(const std::string& vertex_source, const std::string& fragment_source)
+	{
+		uint64_t hash = Hash(driver);
+		hash = Hash(vertex_source, hash);
+		hash = Hash(std::string(1, '\0'), hash); //Keeps moving text between the two stages from colliding
+		return Hash(fragment_source, hash);
+	}
+
+	static std::string glString(GLenum name)
+	{
+		const GLubyte* value = glGetString(name);
+		return value ? (const char*)value : "";
+	}
+
+	void readFile()
+	{
+		std::ifstream file(file_path, std::ios::binary | std::ios::ate);
+		if (!file.is_open()) { return; } //First run
+		std::streamoff file_size = file.tellg();
+		file.seekg(0);
+
+		uint32_t magic = 0, version = 0, count = 0;
+		file.read((char*)&magic, sizeof(magic));
+		file.read((char*)&version, sizeof(version));
+		file.read((char*)&count, sizeof(count));
+		if (!file || magic != FILE_MAGIC || version != FILE_VERSION)
+		{
+			std::cerr << "Warning: Ignoring unreadable shader cache " << file_path << std::endl;
+			return;
+		}
+
+		for (uint32_t i = 0; i < count; i++)
+		{
+			uint64_t entry_key = 0;
+			uint32_t length = 0;
+			Entry entry;
+			file.read((char*)&entry_key, sizeof(entry_key));
+			file.read((char*)&entry.format, sizeof(entry.format));
+			file.read((char*)&length, sizeof(length));
+			if (!file || length > file_size - file.tellg())
+			{ //Truncated or corrupt, the length cannot be trusted and neither can anything read before it
+				std::cerr << "Warning: Dropping corrupt shader cache " << file_path << std::endl;
+				stored.clear();
+				return;
+			}
+
+			entry.binary.resize(length);
+			file.read(entry.binary.data(), length);
+			if (!file)
+			{
+				std::cerr << "Warning: Dropping corrupt shader cache " << file_path << std::endl;
+				stored.clear();
+				return;
+			}
+			stored[entry_key] = std::move(entry);
+		}
+	}
+
+public:
+	//64 bit FNV-1a, chained by passing the previous hash
+	static uint64_t Hash(const std::string& data, uint64_t hash = FNV_OFFSET)
+	{
+		for (unsigned char c : data)
+		{
+			hash ^= c;
+			hash *= FNV_PRIME;
+		}
+		return hash;
+	}
+
+	//Needs a current context. Returns false when the driver cannot save program binaries, loads then always miss.
+	bool Initialize(const std::string& cache_path)
+	{
+		GLint formats = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+		if (formats <= 0) { return false; }
+
+		file_path = cache_path;
+		driver = glString(GL_VENDOR) + "|" + glString(GL_RENDERER) + "|" + glString(GL_VERSION);
+		enabled = true;
+		readFile();
+		return true;
+	}
+
+	//Links the program from a cached binary. False when there is none or the driver rejects it, the caller compiles from source.
+	bool Load(Shader& shader, const std::string& vertex_source, const std::string& fragment_source)
+	{
+		if (!enabled) { return false; }
+
+		uint64_t program_key = key(vertex_source, fragment_source);
+		auto cached = stored.find(program_key);
+		if (cached == stored.end() || !shader.LoadBinary(cached->second.format, cached->second.binary))
+		{
+			misses++;
+			return false;
+		}
+
+		used[program_key] = cached->second;
+		hits++;
+		return true;
+	}
+
+	//Keeps the binary of a program just linked from source
+	void Store(Shader& shader, const std::string& vertex_source, const std::string& fragment_source)
+	{
+		if (!enabled) { return; }
+
+		Entry entry;
+		if (!shader.GetBinary(entry.format, entry.binary)) { return; }
+		used[key(vertex_source, fragment_source)] = std::move(entry);
+		dirty = true;
+	}
+
+	//Writes the cache back if anything was compiled from source
+	bool Save()
+	{
+		if (!enabled || (!dirty && used.size() == stored.size())) { return true; }
+
+		std::ofstream file(file_path, std::ios::binary | std::ios::trunc);
+		if (!file.is_open())
+		{
+			std::cerr << "Error: Could not write shader cache " << file_path << std::endl;
+			return false;
+		}
+
+		uint32_t header[3] = { FILE_MAGIC, FILE_VERSION, (uint32_t)used.size() };
+		file.write((const char*)header, sizeof(header));
+		for (const auto& entry : used)
+		{
+			uint32_t length = entry.second.binary.size();
+			file.write((const char*)&entry.first, sizeof(entry.first));
+			file.write((const char*)&entry.second.format, sizeof(entry.second.format));
+			file.write((const char*)&length, sizeof(length));
+			file.write(entry.second.binary.data(), length);
+		}
+		dirty = false;
+		return true;
+	}
+
+	unsigned int getHits()
+	{
+		return hits;
+	}
+
+	unsigned int getMisses()
+	{
+		return misses;
+	}
+};
+
+#endif
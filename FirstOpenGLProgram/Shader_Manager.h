@@ -0,0 +1,316 @@
+#pragma once
+#ifndef SHADER_MANAGER_H
+#define SHADER_MANAGER_H
+
+#include <sys/stat.h>
+
+#include "Main_Header.h"
+#include "Shader.h"
+#include "Shader_Cache.h"
+#include "Debug_Output.h"
+
+//Builds every program at startup and rebuilds them in the background when their source files change.
+//Rebuilt programs are swapped into the existing Shader objects, so pointers held elsewhere stay valid.
+//Sources may #include "file" relative to themselves, and each program can be given #defines to compile a specialized variant.
+class ShaderManager
+{
+private:
+	const double POLL_INTERVAL = 0.5; //Seconds between checks of the source files
+
+	struct Program
+	{
+		Shader* shader;
+		std::string vertex_path;
+		std::string fragment_path;
+		std::vector<std::string> defines;
+		std::function<void(Shader*)> on_reload; //Overrides the manager wide callback
+		std::vector<std::string> files; //Both stages and everything they include, for hot reload
+		Shader* pending = NULL; //Compiling in the background, swapped in once it links
+		std::string pending_sources[2];
+	};
+
+	std::vector<Program> programs;
+	std::map<std::string, time_t> modified_times;
+	std::function<void(Shader*)> on_reload;
+
+	ShaderCache cache;
+	bool use_cache = true;
+	bool hot_reload = false;
+	double last_poll = 0.0;
+	double build_ms = 0.0;
+
+	static time_t modifiedTime(const std::string& path)
+	{
+		struct stat info;
+		return stat(path.c_str(), &info) == 0 ? info.st_mtime : 0;
+	}
+
+	std::string label(const Program& program)
+	{
+		std::string name = program.vertex_path + " + " + program.fragment_path;
+		for (unsigned int i = 0; i < program.defines.size(); i++)
+		{
+			name += (i == 0 ? " [" : " ") + program.defines[i];
+		}
+		return program.defines.empty() ? name : name + "]";
+	}
+
+	//Pastes the file into source, replacing #include lines with the files they name. #line directives keep compiler errors
+	//pointing at the right line, the source string number is the file's index in files. Each file is only included once.
+	bool appendFile(const std::string& path, const std::string& defines, std::string& source, std::vector<std::string>& files)
+	{
+		if (std::find(files.begin(), files.end(), path) != files.end()) { return true; }
+
+		std::ifstream file(path);
+		if (!file.is_open())
+		{
+			std::cerr << "Error: Could not open shader file " << path << std::endl;
+			return false;
+		}
+
+		int file_index = files.size();
+		files.push_back(path);
+		std::string directory = path.substr(0, path.find_last_of('/') + 1);
+		if (file_index > 0) { source += "#line 1 " + std::to_string(file_index) + "\n"; }
+
+		std::string line;
+		int line_number = 0;
+		while (std::getline(file, line))
+		{
+			line_number++;
+			size_t begin = line.find_first_not_of(" \t");
+			if (begin != std::string::npos && line.compare(begin, 8, "#include") == 0)
+			{
+				size_t open = line.find('"', begin);
+				size_t close = open == std::string::npos ? open : line.find('"', open + 1);
+				if (close == std::string::npos)
+				{
+					std::cerr << "Error: Malformed #include in " << path << " line " << line_number << std::endl;
+					return false;
+				}
+				if (!appendFile(directory + line.substr(open + 1, close - open - 1), defines, source, files)) { return false; }
+				source += "#line " + std::to_string(line_number + 1) + " " + std::to_string(file_index) + "\n";
+				continue;
+			}
+
+			source += line + "\n";
+			if (file_index == 0 && line_number == 1 && !defines.empty())
+			{ //Defines go straight after #version, which has to stay the first line
+				source += defines + "#line 2 0\n";
+			}
+		}
+		return true;
+	}
+
+	//Reads both stages of a program with its defines, recording every file read
+	void readSources(Program& program, std::string& vertex_source, std::string& fragment_source)
+	{
+		std::string defines;
+		for (const std::string& define : program.defines) { defines += "#define " + define + "\n"; }
+
+		program.files.clear();
+		appendFile(program.vertex_path, defines, vertex_source, program.files);
+		std::vector<std::string> fragment_files;
+		appendFile(program.fragment_path, defines, fragment_source, fragment_files);
+		program.files.insert(program.files.end(), fragment_files.begin(), fragment_files.end());
+
+		for (const std::string& file : program.files)
+		{
+			if (modified_times.find(file) == modified_times.end()) { modified_times[file] = modifiedTime(file); }
+		}
+	}
+
+	//Links from the cache, or starts compiling from source. False when the sources still need FinishLink.
+	bool startBuild(Program& program)
+	{
+		std::string vertex_source, fragment_source;
+		readSources(program, vertex_source, fragment_source);
+		if (cache.Load(*program.shader, vertex_source, fragment_source)) { return true; }
+
+		program.shader->CompileShader(GL_VERTEX_SHADER, vertex_source.c_str());
+		program.shader->CompileShader(GL_FRAGMENT_SHADER, fragment_source.c_str());
+		program.shader->StartLink();
+		program.pending_sources[0] = vertex_source;
+		program.pending_sources[1] = fragment_source;
+		return false;
+	}
+
+	bool finishBuild(Program& program)
+	{
+		if (!program.shader->FinishLink())
+		{
+			std::cerr << "Error: Shader Program " << label(program) << " Failed to Finialize!\n" << std::endl;
+			return false;
+		}
+		cache.Store(*program.shader, program.pending_sources[0], program.pending_sources[1]);
+		program.pending_sources[0].clear();
+		program.pending_sources[1].clear();
+		return true;
+	}
+
+	void startReload(Program& program)
+	{
+		delete program.pending; //A newer edit replaces a compile still in flight
+		program.pending = new Shader();
+		program.pending_sources[0].clear();
+		program.pending_sources[1].clear();
+		readSources(program, program.pending_sources[0], program.pending_sources[1]);
+
+		if (!program.pending->Initialize())
+		{
+			delete program.pending;
+			program.pending = NULL;
+			return;
+		}
+		program.pending->CompileShader(GL_VERTEX_SHADER, program.pending_sources[0].c_str());
+		program.pending->CompileShader(GL_FRAGMENT_SHADER, program.pending_sources[1].c_str());
+		program.pending->StartLink();
+	}
+
+	void finishReload(Program& program)
+	{
+		if (program.pending->FinishLink())
+		{
+			std::swap(program.shader->m_shaderProg, program.pending->m_shaderProg); //The old program goes away with pending
+			debug_output.Label(GL_PROGRAM, program.shader->m_shaderProg, label(program));
+			cache.Store(*program.shader, program.pending_sources[0], program.pending_sources[1]);
+			cache.Save();
+			if (program.on_reload) { program.on_reload(program.shader); }
+			else if (on_reload) { on_reload(program.shader); }
+			std::cout << "Reloaded " << label(program) << std::endl;
+		}
+		else
+		{
+			std::cerr << "Error: Reloading " << label(program) << " failed, keeping the previous program" << std::endl;
+		}
+
+		delete program.pending;
+		program.pending = NULL;
+	}
+
+public:
+	~ShaderManager()
+	{
+		for (Program& program : programs) { delete program.pending; }
+	}
+
+	//Built by the next Build call
+	void Add(Shader* shader, const std::string& vertex_path, const std::string& fragment_path,
+		const std::vector<std::string>& defines = {}, std::function<void(Shader*)> reload_callback = nullptr)
+	{
+		programs.push_back({ shader, vertex_path, fragment_path, defines, reload_callback });
+	}
+
+	//Builds a program right away, for variants first needed after startup. Blocks until it links.
+	bool Compile(Shader* shader, const std::string& vertex_path, const std::string& fragment_path,
+		const std::vector<std::string>& defines = {}, std::function<void(Shader*)> reload_callback = nullptr)
+	{
+		auto compile_begin = std::chrono::steady_clock::now();
+		Add(shader, vertex_path, fragment_path, defines, reload_callback);
+		Program& program = programs.back();
+		if (!shader->Initialize()) { return false; }
+
+		if (!startBuild(program))
+		{
+			if (!finishBuild(program)) { return false; }
+			cache.Save();
+		}
+		debug_output.Label(GL_PROGRAM, shader->m_shaderProg, label(program));
+
+		double compile_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - compile_begin).count();
+		std::cout << "Compiled " << label(program) << " on demand in " << compile_ms << " ms" << std::endl;
+		return true;
+	}
+
+	//Called after a program is swapped in, to set its one time uniforms again
+	void setReloadCallback(std::function<void(Shader*)> callback)
+	{
+		on_reload = callback;
+	}
+
+	void setCache(bool enabled)
+	{ //Must be set before Build
+		use_cache = enabled;
+	}
+
+	void setHotReload(bool enabled)
+	{
+		hot_reload = enabled;
+	}
+
+	//Links every added program, from the cache where possible. All compiles are started before any result is checked,
+	//so with parallel shader compile the driver works on every program at once.
+	bool Build(const std::string& cache_path)
+	{
+		auto build_begin = std::chrono::steady_clock::now();
+		if (GLEW_KHR_parallel_shader_compile) { glMaxShaderCompilerThreadsKHR(0xFFFFFFFF); } //As many threads as the driver likes
+		if (use_cache && !cache.Initialize(cache_path))
+		{
+			std::cout << "Program binaries are not supported, shaders are compiled from source" << std::endl;
+		}
+
+		std::vector<Program*> compiling;
+		for (Program& program : programs)
+		{
+			if (!program.shader->Initialize())
+			{
+				std::cerr << "Error: Shader Could Not Initialize!\n" << std::endl;
+				return false;
+			}
+			if (!startBuild(program)) { compiling.push_back(&program); }
+		}
+
+		for (Program* program : compiling)
+		{
+			if (!finishBuild(*program)) { return false; }
+		}
+		cache.Save();
+
+		for (Program& program : programs) { debug_output.Label(GL_PROGRAM, program.shader->m_shaderProg, label(program)); }
+
+		build_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - build_begin).count();
+		std::cout << "Shaders: " << programs.size() << " programs in " << build_ms << " ms, " << cache.getHits() << " from cache ("
+			<< (isCacheWarm() ? "warm" : "cold") << " start)" << std::endl;
+		return true;
+	}
+
+	//Call between frames. Swaps in programs that finished compiling, then looks for edited source files.
+	void Update()
+	{
+		if (!hot_reload) { return; }
+
+		for (Program& program : programs)
+		{
+			if (program.pending && program.pending->isLinkDone()) { finishReload(program); }
+		}
+
+		double now = glfwGetTime();
+		if (now - last_poll < POLL_INTERVAL) { return; }
+		last_poll = now;
+
+		for (auto& file : modified_times)
+		{
+			time_t modified = modifiedTime(file.first);
+			if (modified == file.second) { continue; }
+			file.second = modified;
+
+			for (Program& program : programs)
+			{
+				if (std::find(program.files.begin(), program.files.end(), file.first) != program.files.end()) { startReload(program); }
+			}
+		}
+	}
+
+	double getBuildTime()
+	{
+		return build_ms;
+	}
+
+	//True when every program was linked from a cached binary
+	bool isCacheWarm()
+	{
+		return cache.getHits() > 0 && cache.getMisses() == 0;
+	}
+};
+
+#endif
@@ -0,0 +1,144 @@
+#pragma once
+#ifndef SHADER_VARIANTS_H
+#define SHADER_VARIANTS_H
+
+#include "Main_Header.h"
+#include "Shader.h"
+#include "Shader_Manager.h"
+
+//One shader pair compiled into specialized programs, one per combination of features. Each feature is a #define in the
+//source, so a variant only contains the code it needs instead of branching on uniforms at runtime.
+class ShaderVariants
+{
+public:
+	enum Feature
+	{
+		INSTANCED = 1 << 0, //Model matrix rebuilt from per instance orbits
+		EMISSIVE = 1 << 1, //Adds the emission map
+		NORMAL_MAP = 1 << 2, //Perturbs the vertex normal with the normal map
+		SHADOWS = 1 << 3, //Samples the shadow cube map for the shadowed light
+		TRANSPARENT = 1 << 4, //Writes the weighted blended transparency targets instead of the scene color
+		SHADOW_PCF_MEDIUM = 1 << 5, //Eight shadow taps instead of one, with SHADOWS
+		SHADOW_PCF_SOFT = 1 << 6, //Twenty shadow taps, with SHADOWS
+		NORMAL_INVERSE = 1 << 7, //Inverts the model matrix per vertex for normals, the old path kept for --vertex-probe comparisons
+		FEATURE_COUNT = 8
+	};
+
+	typedef std::function<void(Shader&, unsigned int)> Setup;
+
+private:
+	ShaderManager* manager;
+	std::string vertex_path;
+	std::string fragment_path;
+	unsigned int supported; //Features the source checks for, the rest are dropped so they cannot duplicate programs
+
+	std::map<unsigned int, Shader*> variants; //Keyed by feature mask
+	Setup defaults; //One time uniforms, applied when a variant is built or reloaded
+	Setup pass_setup; //Per pass uniforms, applied the first time a variant is used in a pass
+	std::set<Shader*> prepared;
+	Shader* current = NULL;
+
+	std::function<void(Shader*)> reloadCallback(unsigned int features)
+	{
+		return [this, features](Shader* shader)
+		{ //Reloads are swapped in between frames, the next pass sets the per pass uniforms again anyway
+			if (!defaults) { return; }
+			shader->Enable();
+			defaults(*shader, features);
+		};
+	}
+
+public:
+	ShaderVariants(ShaderManager* shader_manager, const std::string& vertex, const std::string& fragment, unsigned int features)
+		: manager(shader_manager), vertex_path(vertex), fragment_path(fragment), supported(features)
+	{
+	}
+
+	~ShaderVariants()
+	{
+		for (auto& variant : variants) { delete variant.second; }
+	}
+
+	//The #define for each feature set in the mask
+	static std::vector<std::string> Defines(unsigned int features)
+	{
+		static const char* names[FEATURE_COUNT] = { "INSTANCED", "EMISSIVE", "NORMAL_MAP", "SHADOWS", "TRANSPARENT", "SHADOW_PCF_MEDIUM", "SHADOW_PCF_SOFT", "NORMAL_INVERSE" };
+		std::vector<std::string> defines;
+		for (unsigned int i = 0; i < FEATURE_COUNT; i++)
+		{
+			if (features & (1u << i)) { defines.push_back(names[i]); }
+		}
+		return defines;
+	}
+
+	void setDefaults(Setup setup)
+	{
+		defaults = setup;
+	}
+
+	//Queues variants known to be needed for the manager's next Build, so they compile in parallel at startup
+	void Prepare(const std::vector<unsigned int>& masks)
+	{
+		for (unsigned int mask : masks)
+		{
+			unsigned int features = mask & supported;
+			if (variants.count(features)) { continue; }
+			variants[features] = new Shader();
+			manager->Add(variants[features], vertex_path, fragment_path, Defines(features), reloadCallback(features));
+		}
+	}
+
+	//Applies the one time uniforms to the prepared variants, call after the manager has built them
+	void ApplyDefaults()
+	{
+		if (!defaults) { return; }
+		for (auto& variant : variants)
+		{
+			variant.second->Enable();
+			defaults(*variant.second, variant.first);
+		}
+		current = NULL;
+	}
+
+	//The variant for a feature mask, compiled now if nothing asked for it before
+	Shader* Get(unsigned int mask)
+	{
+		unsigned int features = mask & supported;
+		auto variant = variants.find(features);
+		if (variant != variants.end()) { return variant->second; }
+
+		Shader* shader = new Shader();
+		variants[features] = shader;
+		manager->Compile(shader, vertex_path, fragment_path, Defines(features), reloadCallback(features)); //Errors are reported, the failed program draws nothing
+		if (defaults)
+		{
+			shader->Enable();
+			defaults(*shader, features);
+		}
+		current = NULL;
+		return shader;
+	}
+
+	//Starts a pass, setup runs on each variant the first time the pass uses it. Only this family's programs may be enabled until the pass ends.
+	void Begin(Setup setup)
+	{
+		pass_setup = setup;
+		prepared.clear();
+		current = NULL;
+	}
+
+	//Enables the variant for a feature mask, skipping the switch when it is already bound
+	Shader* Use(unsigned int mask)
+	{
+		Shader* shader = Get(mask);
+		if (shader != current)
+		{
+			shader->Enable();
+			current = shader;
+		}
+		if (pass_setup && prepared.insert(shader).second) { pass_setup(*shader, mask & supported); }
+		return shader;
+	}
+};
+
+#endif
@@ -0,0 +1,216 @@
+#pragma once
+#ifndef SHADOW_MAP_H
+#define SHADOW_MAP_H
+
+#include "Main_Header.h"
+#include "Shader.h"
+#include "Render_Stats.h"
+#include "Debug_Output.h"
+#include "Memory_Tracker.h"
+
+//Omnidirectional shadows for one point light. Casters that barely move are kept in a cached cube map that is refreshed a few
+//faces at a time, each frame the cache is copied into the sampled cube map and only the moving casters are drawn on top.
+class ShadowMap
+{
+public:
+	enum Layer { CACHED, DYNAMIC };
+
+	enum Filter
+	{
+		PCF_HARD, //One hardware filtered tap
+		PCF_MEDIUM, //Eight taps on the corners of a cube around the sample
+		PCF_SOFT, //Twenty taps, corners and edge midpoints
+		FILTER_COUNT
+	};
+
+	static const unsigned int FACES = 6;
+
+private:
+	const float NEAR_PLANE = 0.5f;
+
+	int size = 0;
+	float far_plane = 0.f;
+	unsigned int faces_per_refresh = 1;
+
+	unsigned int cube_maps[2] = { 0, 0 }; //Indexed by Layer
+	unsigned int framebuffer = 0;
+
+	glm::vec3 light_position = glm::vec3(0.f);
+	glm::mat4 face_matrices[FACES];
+	bool cache_valid = false;
+	unsigned int next_refresh_face = 0;
+	std::vector<unsigned int> stale_faces;
+
+	unsigned int createCubeMap(const std::string& name)
+	{
+		unsigned int cube_map;
+		glGenTextures(1, &cube_map);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, cube_map);
+		for (unsigned int face = 0; face < FACES; face++)
+		{
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, GL_DEPTH_COMPONENT32F, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, NULL);
+		}
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR); //With compare mode on, linear filtering gives 2x2 PCF for free
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+
+		debug_output.Label(GL_TEXTURE, cube_map, name);
+		memory_tracker.Allocate(GL_TEXTURE, cube_map, MemoryTracker::RENDER_TARGET, name, MemoryTracker::TextureBytes(size, size, 4, false) * FACES);
+		return cube_map;
+	}
+
+	void buildFaceMatrices()
+	{ //Same face order and up vectors as the cube map faces, so face i of the matrices renders into GL_TEXTURE_CUBE_MAP_POSITIVE_X + i
+		static const glm::vec3 directions[FACES] = { glm::vec3(1.f, 0.f, 0.f), glm::vec3(-1.f, 0.f, 0.f), glm::vec3(0.f, 1.f, 0.f),
+			glm::vec3(0.f, -1.f, 0.f), glm::vec3(0.f, 0.f, 1.f), glm::vec3(0.f, 0.f, -1.f) };
+		static const glm::vec3 ups[FACES] = { glm::vec3(0.f, -1.f, 0.f), glm::vec3(0.f, -1.f, 0.f), glm::vec3(0.f, 0.f, 1.f),
+			glm::vec3(0.f, 0.f, -1.f), glm::vec3(0.f, -1.f, 0.f), glm::vec3(0.f, -1.f, 0.f) };
+
+		glm::mat4 projection = glm::perspective(glm::radians(90.f), 1.f, NEAR_PLANE, far_plane);
+		for (unsigned int face = 0; face < FACES; face++)
+		{
+			face_matrices[face] = projection * glm::lookAt(light_position, light_position + directions[face], ups[face]);
+		}
+	}
+
+public:
+	~ShadowMap()
+	{
+		for (unsigned int& cube_map : cube_maps)
+		{
+			if (cube_map == 0) { continue; }
+			memory_tracker.Free(GL_TEXTURE, cube_map);
+			glDeleteTextures(1, &cube_map);
+		}
+		if (framebuffer != 0) { glDeleteFramebuffers(1, &framebuffer); }
+	}
+
+	bool Initialize(int map_size, float map_far_plane)
+	{
+		size = map_size;
+		far_plane = map_far_plane;
+		cube_maps[CACHED] = createCubeMap("Shadow Map Cached");
+		cube_maps[DYNAMIC] = createCubeMap("Shadow Map");
+		glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+
+		glGenFramebuffers(1, &framebuffer);
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X, cube_maps[CACHED], 0);
+		glDrawBuffer(GL_NONE); //Depth only
+		glReadBuffer(GL_NONE);
+		debug_output.Label(GL_FRAMEBUFFER, framebuffer, "Shadow Map FBO");
+
+		bool complete = glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE;
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		if (!complete)
+		{
+			std::cerr << "Error: Shadow map framebuffer not complete!" << std::endl;
+			return false;
+		}
+
+		buildFaceMatrices();
+		return true;
+	}
+
+	//Moving the light invalidates everything in the cache
+	void setLightPosition(glm::vec3 position)
+	{
+		if (position == light_position) { return; }
+		light_position = position;
+		buildFaceMatrices();
+		cache_valid = false;
+	}
+
+	//How many cached faces are redrawn each frame, a full refresh takes FACES / faces frames
+	void setCacheRefresh(unsigned int faces)
+	{
+		faces_per_refresh = std::max(1u, std::min(faces, (unsigned int)FACES));
+	}
+
+	void InvalidateCache()
+	{
+		cache_valid = false;
+	}
+
+	//Faces of the cached layer to redraw this frame, all of them after the cache was invalidated
+	const std::vector<unsigned int>& getStaleFaces()
+	{
+		stale_faces.clear();
+		unsigned int count = cache_valid ? faces_per_refresh : FACES;
+		for (unsigned int i = 0; i < count; i++)
+		{
+			stale_faces.push_back(next_refresh_face);
+			next_refresh_face = (next_refresh_face + 1) % FACES;
+		}
+		cache_valid = true;
+		return stale_faces;
+	}
+
+	const glm::mat4& getFaceMatrix(unsigned int face)
+	{
+		return face_matrices[face];
+	}
+
+	glm::vec3 getLightPosition()
+	{
+		return light_position;
+	}
+
+	float getFarPlane()
+	{
+		return far_plane;
+	}
+
+	//Sphere against the four side planes and the depth range of a face, casters outside it cannot shadow anything seen through it
+	bool isVisible(unsigned int face, glm::vec3 center, float radius)
+	{
+		glm::vec3 offset = center - light_position;
+		unsigned int axis = face / 2;
+		float depth = (face % 2 == 0) ? offset[axis] : -offset[axis];
+		if (depth + radius < NEAR_PLANE || depth - radius > far_plane) { return false; }
+
+		//The side planes are at 45 degrees, so the distance to each is (depth - |side|) / sqrt(2)
+		for (unsigned int side = 0; side < 3; side++)
+		{
+			if (side == axis) { continue; }
+			if (depth - std::abs(offset[side]) < -radius * 1.41421356f) { return false; }
+		}
+		return true;
+	}
+
+	//Binds one face of a layer for rendering, cached faces are cleared since they are drawn from scratch
+	void BindFace(Layer layer, unsigned int face)
+	{
+		glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, cube_maps[layer], 0);
+		render_stats.CountFramebuffer();
+		glViewport(0, 0, size, size);
+		if (layer == CACHED) { glClear(GL_DEPTH_BUFFER_BIT); }
+	}
+
+	//Starts the frame's shadow map from the cached casters
+	void CopyCache()
+	{
+		glCopyImageSubData(cube_maps[CACHED], GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0, cube_maps[DYNAMIC], GL_TEXTURE_CUBE_MAP, 0, 0, 0, 0, size, size, FACES);
+	}
+
+	//Binds the finished shadow map to a texture unit and sets the lookup uniforms
+	void Bind(Shader& shader, unsigned int unit, int light_index)
+	{
+		glActiveTexture(GL_TEXTURE0 + unit);
+		glBindTexture(GL_TEXTURE_CUBE_MAP, cube_maps[DYNAMIC]);
+		render_stats.CountTexture();
+		glActiveTexture(GL_TEXTURE0);
+
+		uploadUniform(glUniform1i, shader.GetUniformLocation("shadow_map"), unit);
+		uploadUniform(glUniform1i, shader.GetUniformLocation("shadow_light"), light_index);
+		uploadUniform(glUniform3fv, shader.GetUniformLocation("shadow_light_position"), 1, glm::value_ptr(light_position));
+		uploadUniform(glUniform1f, shader.GetUniformLocation("shadow_far_plane"), far_plane);
+	}
+};
+
+#endif
@@ -0,0 +1,43 @@
+#pragma once
+#ifndef SOLAR_SYSTEM_H
+#define SOLAR_SYSTEM_H
+
+#include "Core_Header.h"
+
+void computeTransforms(double elapsed_time, std::vector<float> speed, std::vector<float> dist, std::vector<float> rotation_speed, std::vector<float> scale,
+	glm::vec3 rotation_vector, glm::mat4 &tmat, glm::mat4 &rmat, glm::mat4 &smat)
+{
+	tmat = glm::translate(glm::mat4(1.f), glm::vec3(cos(speed[0] * elapsed_time) * dist[0], sin(speed[1] * elapsed_time) * dist[1], sin(speed[2] * elapsed_time) * dist[2]));
+	rmat = glm::rotate(glm::mat4(1.f), rotation_speed[0] * (float)elapsed_time, rotation_vector);
+	smat = glm::scale(glm::vec3(scale[0], scale[1], scale[2]));
+}
+
+//Pushes the sun, earth, moon, jupiter and jupiter's moon transforms at a point in simulation time. Needs no GL state.
+void computeSolarSystem(double elapsed_time, std::stack<std::pair<std::string, glm::mat4>>& planet_stack)
+{
+	glm::mat4 tmat, rmat, smat;
+
+	//sun transform
+	computeTransforms(elapsed_time, { 0.f, 0.f, 0.f }, { 0.f, 0.f, 0.f }, { 0.05f, 0.0f, 0.05f }, { 2.f, 2.f, 2.f }, glm::vec3(0.0f, 1.0f, 0.0f), tmat, rmat, smat);
+	planet_stack.push(std::make_pair("sun", tmat * rmat * smat));
+
+	//jupiter transform
+	computeTransforms(elapsed_time, { 0.06f, 0.f, 0.06f }, { 82.f, 0.f, 82.f }, { 0.03f, 0.0f, 0.03f }, { 8.f, 8.f, 8.f }, glm::vec3(0.0f, 1.0f, 0.0f), tmat, rmat, smat);
+	std::pair<std::string, glm::mat4> juptier_transform = std::make_pair("jupiter", planet_stack.top().second * tmat * rmat * smat);
+
+	//earth transform
+	computeTransforms(elapsed_time, { 0.10f, 0.0f, 0.10f }, { 40.f, 0.0f, 40.0f }, { 0.15f, 0.0f, 0.15f }, { 2.f, 2.f, 2.f }, glm::vec3(0.0f, 1.0f, 0.0f), tmat, rmat, smat);
+	planet_stack.push(std::make_pair("earth", planet_stack.top().second * tmat * rmat * smat));
+
+	//moon transform
+	computeTransforms(elapsed_time, { 0.1f, 0.1f, 0.f }, { 5.f, 5.f, 0.f }, { 0.15f, 0.0f, 0.15f }, { .5f, .5f, .5f }, glm::vec3(0.f, 1.f, 0.f), tmat, rmat, smat);
+	planet_stack.push(std::make_pair("moon", planet_stack.top().second * tmat * rmat * smat));
+
+	planet_stack.push(juptier_transform);
+
+	//jupiter moon transform
+	computeTransforms(elapsed_time, { 0.1f, 0.1f, 0.f }, { 1.5f, 1.5f, 0.f }, { 0.15f, 0.0f, 0.15f }, { .1f, .1f, .1f }, glm::vec3(0.f, 1.f, 0.f), tmat, rmat, smat);
+	planet_stack.push(std::make_pair("j_moon", planet_stack.top().second * tmat * rmat * smat));
+}
+
+#endif
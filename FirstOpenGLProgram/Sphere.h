@@ -10,52 +10,17 @@ class Sphere : public Object
 private:
 	int precision = 20;
 
-	void loadModel()
+public:
+	//Builds the vertices and indices on the CPU, Initialize uploads them.
+	void Generate(int precision)
 	{
-		for (int i = 0; i <= precision; i++) //Compute Vertices
-		{
-			for (int j = 0; j <= precision; j++)
-			{
-				float y = (float)cos(glm::radians(180.f - i * 180.f / precision));
-				float x = -(float)cos(glm::radians(j * 360.f / precision)) * (float)abs(cos(asin(y)));
-				float z = (float)sin(glm::radians(j * 360.f / precision)) * (float)abs(cos(asin(y)));
-				Vertices[i * (precision + 1) + j].vertex = glm::vec3(x, y, z);
-				Vertices[i * (precision + 1) + j].normal = glm::vec3(x, y, z);
-				Vertices[i * (precision + 1) + j].texture_coords = glm::vec2(((float)j / precision), ((float)i / precision));
-			}
-		}
-
-		for (int i = 0; i < precision; i++) //Compute Indices
-		{
-			for (int j = 0; j < precision; j++)
-			{
-				Indices[6 * (i * precision + j) + 0] = i * (precision + 1) + j;
-				Indices[6 * (i * precision + j) + 1] = i * (precision + 1) + j + 1;
-				Indices[6 * (i * precision + j) + 2] = (i + 1) * (precision + 1) + j;
-				Indices[6 * (i * precision + j) + 3] = i * (precision + 1) + j + 1;
-				Indices[6 * (i * precision + j) + 4] = (i + 1) * (precision + 1) + j + 1;
-				Indices[6 * (i * precision + j) + 5] = (i + 1) * (precision + 1) + j;
-			}
-		}
+		this->precision = precision;
+		generateSphere(precision);
 	}
 
-public:
 	void Initialize(const char* diffuse_map_path)
 	{
-		int num_vertices = (precision + 1) * (precision + 1);
-		int num_indices = precision * precision * 6;
-
-		for (int i = 0; i < num_vertices; i++)
-		{
-			Vertex new_vertex;
-			Vertices.push_back(new_vertex);
-		}
-		for (int i = 0; i < num_indices; i++)
-		{
-			Indices.push_back(0);
-		}
-
-		loadModel();
+		Generate(precision);
 
 		glGenVertexArrays(1, &VAO);
 		glGenBuffers(1, &VB);
@@ -66,10 +31,18 @@ public:
 		//Vertex VBO
 		glBindBuffer(GL_ARRAY_BUFFER, VB);
 		glBufferData(GL_ARRAY_BUFFER, sizeof(Vertex) * Vertices.size(), &Vertices[0], GL_STATIC_DRAW);
+		render_stats.CountBufferUpload(sizeof(Vertex) * Vertices.size());
 
 		//Index VBO
 		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, IB);
 		glBufferData(GL_ELEMENT_ARRAY_BUFFER, sizeof(unsigned int) * Indices.size(), &Indices[0], GL_STATIC_DRAW);
+		render_stats.CountBufferUpload(sizeof(unsigned int) * Indices.size());
+		memory_tracker.Allocate(GL_BUFFER, VB, MemoryTracker::VERTEX_BUFFER, "Sphere", sizeof(Vertex) * Vertices.size());
+		memory_tracker.Allocate(GL_BUFFER, IB, MemoryTracker::INDEX_BUFFER, "Sphere", sizeof(unsigned int) * Indices.size());
+
+		debug_output.Label(GL_VERTEX_ARRAY, VAO, "Sphere VAO");
+		debug_output.Label(GL_BUFFER, VB, "Sphere Vertices");
+		debug_output.Label(GL_BUFFER, IB, "Sphere Indices");
 
 		glEnableVertexAttribArray(0);
 		glEnableVertexAttribArray(1);
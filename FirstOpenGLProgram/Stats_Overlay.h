@@ -0,0 +1,178 @@
+#pragma once
+#ifndef STATS_OVERLAY_H
+#define STATS_OVERLAY_H
+
+#include "Main_Header.h"
+#include "Shader.h"
+#include "Render_Stats.h"
+#include "Debug_Output.h"
+#include "Memory_Tracker.h"
+
+void renderQuad();
+
+class StatsOverlay
+{
+private:
+	//Text is drawn on the CPU into a small texture, then put on screen with the textured quad path
+	static const int COLUMNS = 72;
+	static const int ROWS = 24;
+	static const int CELL_WIDTH = 6; //5x7 glyphs plus spacing
+	static const int CELL_HEIGHT = 9;
+	static const int WIDTH = COLUMNS * CELL_WIDTH;
+	static const int HEIGHT = ROWS * CELL_HEIGHT;
+	static const int SCALE = 2; //Screen pixels per texel
+	static const unsigned int REFRESH_FRAMES = 15; //Rebuilding the text every frame would only make it unreadable
+
+	unsigned int texture = 0;
+	std::vector<unsigned char> pixels;
+	unsigned int frames_since_refresh = REFRESH_FRAMES;
+
+	static const unsigned char* glyph(char c)
+	{
+		static const char GLYPH_CHARACTERS[] = "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ:./-";
+		static const unsigned char GLYPHS[][7] =
+		{
+			{ 0x0E, 0x11, 0x13, 0x15, 0x19, 0x11, 0x0E }, { 0x04, 0x0C, 0x04, 0x04, 0x04, 0x04, 0x0E },
+			{ 0x0E, 0x11, 0x01, 0x02, 0x04, 0x08, 0x1F }, { 0x1F, 0x02, 0x04, 0x02, 0x01, 0x11, 0x0E },
+			{ 0x02, 0x06, 0x0A, 0x12, 0x1F, 0x02, 0x02 }, { 0x1F, 0x10, 0x1E, 0x01, 0x01, 0x11, 0x0E },
+			{ 0x06, 0x08, 0x10, 0x1E, 0x11, 0x11, 0x0E }, { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x08, 0x08 },
+			{ 0x0E, 0x11, 0x11, 0x0E, 0x11, 0x11, 0x0E }, { 0x0E, 0x11, 0x11, 0x0F, 0x01, 0x02, 0x0C },
+			{ 0x0E, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 }, { 0x1E, 0x11, 0x11, 0x1E, 0x11, 0x11, 0x1E },
+			{ 0x0E, 0x11, 0x10, 0x10, 0x10, 0x11, 0x0E }, { 0x1C, 0x12, 0x11, 0x11, 0x11, 0x12, 0x1C },
+			{ 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x1F }, { 0x1F, 0x10, 0x10, 0x1E, 0x10, 0x10, 0x10 },
+			{ 0x0E, 0x11, 0x10, 0x17, 0x11, 0x11, 0x0F }, { 0x11, 0x11, 0x11, 0x1F, 0x11, 0x11, 0x11 },
+			{ 0x0E, 0x04, 0x04, 0x04, 0x04, 0x04, 0x0E }, { 0x07, 0x02, 0x02, 0x02, 0x02, 0x12, 0x0C },
+			{ 0x11, 0x12, 0x14, 0x18, 0x14, 0x12, 0x11 }, { 0x10, 0x10, 0x10, 0x10, 0x10, 0x10, 0x1F },
+			{ 0x11, 0x1B, 0x15, 0x15, 0x11, 0x11, 0x11 }, { 0x11, 0x11, 0x19, 0x15, 0x13, 0x11, 0x11 },
+			{ 0x0E, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, { 0x1E, 0x11, 0x11, 0x1E, 0x10, 0x10, 0x10 },
+			{ 0x0E, 0x11, 0x11, 0x11, 0x15, 0x12, 0x0D }, { 0x1E, 0x11, 0x11, 0x1E, 0x14, 0x12, 0x11 },
+			{ 0x0F, 0x10, 0x10, 0x0E, 0x01, 0x01, 0x1E }, { 0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04 },
+			{ 0x11, 0x11, 0x11, 0x11, 0x11, 0x11, 0x0E }, { 0x11, 0x11, 0x11, 0x11, 0x11, 0x0A, 0x04 },
+			{ 0x11, 0x11, 0x11, 0x15, 0x15, 0x15, 0x0A }, { 0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11 },
+			{ 0x11, 0x11, 0x11, 0x0A, 0x04, 0x04, 0x04 }, { 0x1F, 0x01, 0x02, 0x04, 0x08, 0x10, 0x1F },
+			{ 0x00, 0x0C, 0x0C, 0x00, 0x0C, 0x0C, 0x00 }, { 0x00, 0x00, 0x00, 0x00, 0x00, 0x0C, 0x0C },
+			{ 0x00, 0x01, 0x02, 0x04, 0x08, 0x10, 0x00 }, { 0x00, 0x00, 0x00, 0x1F, 0x00, 0x00, 0x00 },
+		};
+
+		const char* found = strchr(GLYPH_CHARACTERS, toupper(c));
+		if (c == '\0' || !found) { return NULL; } //Spaces and unknown characters stay blank
+		return GLYPHS[found - GLYPH_CHARACTERS];
+	}
+
+	void drawText(int column, int row, const std::string& text)
+	{
+		for (unsigned int i = 0; i < text.size() && column + (int)i < COLUMNS; i++)
+		{
+			const unsigned char* rows = glyph(text[i]);
+			if (!rows) { continue; }
+
+			int x0 = (column + i) * CELL_WIDTH;
+			int y0 = HEIGHT - (row + 1) * CELL_HEIGHT + 1; //Texture rows start at the bottom
+			for (int y = 0; y < 7; y++)
+			{
+				for (int x = 0; x < 5; x++)
+				{
+					if (!(rows[y] & (0x10 >> x))) { continue; }
+					unsigned char* pixel = &pixels[((y0 + 6 - y) * WIDTH + x0 + x) * 4];
+					pixel[0] = pixel[1] = pixel[2] = pixel[3] = 255;
+				}
+			}
+		}
+	}
+
+	static std::string formatCount(unsigned long long value)
+	{
+		char text[16];
+		if (value >= 10000000) { snprintf(text, sizeof(text), "%.1fM", value / 1000000.0); }
+		else if (value >= 100000) { snprintf(text, sizeof(text), "%.1fK", value / 1000.0); }
+		else { snprintf(text, sizeof(text), "%llu", value); }
+		return text;
+	}
+
+	static std::string formatRow(const std::string& name, const RenderStats::Counters& counters)
+	{
+		char row[COLUMNS + 1];
+		snprintf(row, sizeof(row), "%-16.16s%6s%7s%7s%5u%5u%5u%4u%6u%7s", name.c_str(),
+			formatCount(counters.draw_calls).c_str(), formatCount(counters.instances).c_str(), formatCount(counters.triangles).c_str(),
+			counters.program_binds, counters.vao_binds, counters.texture_binds, counters.framebuffer_binds,
+			counters.uniform_uploads, formatCount(counters.buffer_bytes).c_str());
+		return row;
+	}
+
+	void rebuild()
+	{
+		//Dark translucent background so the text stays readable over the scene
+		for (unsigned int i = 0; i < pixels.size(); i += 4)
+		{
+			pixels[i] = pixels[i + 1] = pixels[i + 2] = 0;
+			pixels[i + 3] = 160;
+		}
+
+		char header[COLUMNS + 1];
+		snprintf(header, sizeof(header), "%-16s%6s%7s%7s%5s%5s%5s%4s%6s%7s", "PASS", "DRAWS", "INST", "TRIS", "PROG", "VAO", "TEX", "FBO", "UNIF", "BYTES");
+		drawText(0, 0, header);
+		drawText(0, 1, formatRow("FRAME", render_stats.getLastFrame()));
+
+		int row = 3;
+		for (const RenderStats::Pass& pass : render_stats.getLastPasses())
+		{
+			if (row >= ROWS) { break; }
+			drawText(0, row++, formatRow(pass.name, pass.counters));
+		}
+
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, WIDTH, HEIGHT, GL_RGBA, GL_UNSIGNED_BYTE, &pixels[0]);
+	}
+
+public:
+	~StatsOverlay()
+	{
+		if (texture != 0)
+		{
+			memory_tracker.Free(GL_TEXTURE, texture);
+			glDeleteTextures(1, &texture);
+		}
+	}
+
+	bool Initialize()
+	{
+		pixels.resize(WIDTH * HEIGHT * 4);
+
+		glGenTextures(1, &texture);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, WIDTH, HEIGHT, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		debug_output.Label(GL_TEXTURE, texture, "Stats Overlay");
+		memory_tracker.Allocate(GL_TEXTURE, texture, MemoryTracker::TEXTURE, "Stats Overlay", MemoryTracker::TextureBytes(WIDTH, HEIGHT, 4, false));
+		return true;
+	}
+
+	//Draws into the currently bound framebuffer, in the top left corner.
+	void Render(Shader& texture_shader, int screen_width, int screen_height)
+	{
+		if (++frames_since_refresh >= REFRESH_FRAMES)
+		{
+			rebuild();
+			frames_since_refresh = 0;
+		}
+
+		GLint viewport[4];
+		glGetIntegerv(GL_VIEWPORT, viewport);
+		glViewport(8, screen_height - HEIGHT * SCALE - 8, WIDTH * SCALE, HEIGHT * SCALE);
+		glDisable(GL_DEPTH_TEST);
+
+		texture_shader.Enable();
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(GL_TEXTURE_2D, texture);
+		render_stats.CountTexture();
+		renderQuad();
+
+		glEnable(GL_DEPTH_TEST);
+		glViewport(viewport[0], viewport[1], viewport[2], viewport[3]);
+	}
+};
+
+#endif
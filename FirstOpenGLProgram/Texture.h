@@ -4,6 +4,9 @@
 
 #include "Main_Header.h"
 #include "Shader.h"
+#include "Debug_Output.h"
+#include "Render_Stats.h"
+#include "Texture_Streamer.h"
 
 class Texture
 {
@@ -22,85 +25,29 @@ public:
 		cube_map = loadCubeMapTexture(texture_faces_path);
 	}
 
+	//Drawn across the whole screen, so it is always streamed to full detail
 	unsigned int loadTexture(const char* texture_path)
 	{
-		int width, height, nrComponents;
-		unsigned int texture;
-		glGenTextures(1, &texture);
-
-		stbi_set_flip_vertically_on_load(true);
-
-		//Load Texture
-		unsigned char* data = stbi_load(texture_path, &width, &height, &nrComponents, 0);
-		if (data)
-		{
-			GLenum format;
-			if (nrComponents == 1) { format = GL_RED; }
-			else if (nrComponents == 3) { format = GL_RGB; }
-			else if (nrComponents == 4) { format = GL_RGBA; }
-
-			glBindTexture(GL_TEXTURE_2D, texture);
-			glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, format, GL_UNSIGNED_BYTE, data);
-			glGenerateMipmap(GL_TEXTURE_2D);
-
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-
-			stbi_image_free(data);
-		}
-		else
-		{
-			std::cout << "Texture failed to load at path: " << texture_path << std::endl;
-			stbi_image_free(data);
-		}
-		return texture;
+		return texture_streamer.Load2D(texture_path, true, TextureStreamer::GREY, true);
 	}
 
 	unsigned int loadCubeMapTexture(std::vector<std::string> texture_faces)
 	{
-		int width, height, nr_color_channels;
-
-		unsigned int texture;
-		glGenTextures(1, &texture);
-		glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
-
-		stbi_set_flip_vertically_on_load(false);
-
-		for (unsigned int i = 0; i < texture_faces.size(); i++)
-		{
-			unsigned char* data = stbi_load(texture_faces[i].c_str(), &width, &height, &nr_color_channels, 3);
-			if (data)
-			{
-				glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, 0, GL_RGB, width, height, 0, GL_RGB, GL_UNSIGNED_BYTE, data);
-				stbi_image_free(data);
-			}
-			else
-			{
-				std::cerr << "Failed to Load Cube Map Texture!" << stbi_failure_reason() << std::endl;
-				stbi_image_free(data);
-			}
-		}
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-
-		return texture;
+		return texture_streamer.LoadCubeMap(texture_faces, "Skybox Cube Map");
 	}
 
 	void bindTextures()
 	{
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, diffuse_map);
+		render_stats.CountTexture();
 	}
 
 	void bindCubeMapTextures()
 	{
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_CUBE_MAP, cube_map);
+		render_stats.CountTexture();
 	}
 };
 
@@ -0,0 +1,496 @@
+#pragma once
+#ifndef TEXTURE_STREAMER_H
+#define TEXTURE_STREAMER_H
+
+#include "Main_Header.h"
+#include "Debug_Output.h"
+#include "Memory_Tracker.h"
+#include "Mip_Downsample.h"
+
+//Loads textures in the background. Each texture gets immutable storage for its whole mip chain straight away, with a
+//placeholder texel in the coarsest level, so it can be drawn on the first frame. A decode thread loads the file and
+//builds the mip chain, then the main thread uploads it from the smallest level up through a ring of pixel buffers and
+//lowers GL_TEXTURE_BASE_LEVEL each time a level is complete. Textures are decoded and uploaded in order of their size
+//on screen, and only down to the level that size calls for.
+class TextureStreamer
+{
+public:
+	enum Placeholder
+	{
+		GREY, //Diffuse maps
+		BLACK, //Specular and emission maps, adds nothing until the real texture arrives
+		FLAT_NORMAL //Normal maps, points straight out of the surface
+	};
+
+private:
+	static const int PBO_COUNT = 3; //Frames a staging buffer is left alone before it is written again
+	static const size_t STAGING_BYTES = 4 * 1024 * 1024; //Upload budget per frame, bigger levels are split into bands of rows
+	const float DETAIL_SCALE = 1.f; //Texels per screen pixel across the texture's long side. A sphere only shows half of its texture at once, so this keeps some margin.
+
+	struct Stream
+	{
+		unsigned int texture;
+		GLenum target; //GL_TEXTURE_2D or GL_TEXTURE_CUBE_MAP
+		std::string name;
+		std::vector<std::string> paths; //One per face
+		bool flip;
+		bool pinned; //Covers the screen wherever it is drawn, always streamed to full detail
+		int width, height, channels, levels;
+
+		int resident; //Finest complete level and the texture's GL_TEXTURE_BASE_LEVEL, levels while only the placeholder is there
+		int wanted; //Finest level the last screen size called for
+		float screen_size = 0.f; //Largest hint since the last Update, in pixels
+		float priority = 0.f;
+		bool decoding = false;
+		bool failed = false;
+
+		//Decoded levels waiting for upload, indexed level * faces + face. Uploading works up from resident - 1.
+		std::vector<std::vector<unsigned char>> pixels;
+		int finest_decoded = 0;
+		int face = 0; //Progress through the level being uploaded
+		int row = 0;
+
+		int faces() const
+		{
+			return target == GL_TEXTURE_CUBE_MAP ? 6 : 1;
+		}
+	};
+
+	struct DecodeJob
+	{
+		unsigned int stream;
+		std::vector<std::string> paths;
+		bool flip;
+		int width, height, channels, levels;
+		int finest, coarsest; //Levels kept from the decoded chain
+		float priority;
+
+		std::vector<std::vector<unsigned char>> pixels; //Filled by the decode thread
+		std::string error;
+	};
+
+	std::vector<Stream> streams;
+	std::map<unsigned int, unsigned int> stream_index; //Texture name to stream
+	bool full_detail = false; //Streaming disabled, everything is uploaded at full detail
+
+	unsigned int staging[PBO_COUNT] = {};
+	unsigned int next_staging = 0;
+
+	//Shared with the decode thread
+	std::thread decoder;
+	std::mutex lock;
+	std::condition_variable wake;
+	std::vector<DecodeJob> decode_queue;
+	std::vector<DecodeJob> decoded;
+	bool running = false;
+
+	size_t uploaded_bytes = 0;
+	std::chrono::steady_clock::time_point start_time;
+	double last_upload_ms = 0.0; //When the last upload happened
+
+	static int mipLevels(int width, int height)
+	{
+		int levels = 1;
+		while ((std::max(width, height) >> levels) > 0) { levels++; }
+		return levels;
+	}
+
+	static int levelSize(int size, int level)
+	{
+		return std::max(1, size >> level);
+	}
+
+	static GLenum pixelFormat(int channels)
+	{
+		static const GLenum formats[4] = { GL_RED, GL_RG, GL_RGB, GL_RGBA };
+		return formats[channels - 1];
+	}
+
+	static GLenum internalFormat(int channels)
+	{
+		static const GLenum formats[4] = { GL_R8, GL_RG8, GL_RGB8, GL_RGBA8 };
+		return formats[channels - 1];
+	}
+
+	static GLenum faceTarget(const Stream& stream, int face)
+	{
+		return stream.target == GL_TEXTURE_CUBE_MAP ? GL_TEXTURE_CUBE_MAP_POSITIVE_X + face : GL_TEXTURE_2D;
+	}
+
+	static void decode(DecodeJob& job)
+	{
+		int faces = job.paths.size();
+		job.pixels.assign(job.levels * faces, std::vector<unsigned char>());
+		for (int face = 0; face < faces; face++)
+		{
+			stbi_set_flip_vertically_on_load_thread(job.flip);
+			int width, height, components;
+			unsigned char* data = stbi_load(job.paths[face].c_str(), &width, &height, &components, job.channels);
+			if (!data || width != job.width || height != job.height)
+			{
+				job.error = "Texture failed to load at path: " + job.paths[face] + (data ? " (size changed)" : std::string(" (") + stbi_failure_reason() + ")");
+				stbi_image_free(data);
+				job.pixels.clear();
+				return;
+			}
+
+			std::vector<unsigned char> level(data, data + (size_t)width * height * job.channels);
+			stbi_image_free(data);
+			for (int i = 0; i <= job.coarsest; i++)
+			{
+				std::vector<unsigned char> next;
+				if (i < job.coarsest) { next = downsampleMip(level, levelSize(width, i), levelSize(height, i), job.channels); }
+				if (i >= job.finest) { job.pixels[i * faces + face] = std::move(level); }
+				level = std::move(next);
+			}
+		}
+	}
+
+	void decodeLoop()
+	{
+		while (true)
+		{
+			DecodeJob job;
+			{
+				std::unique_lock<std::mutex> guard(lock);
+				wake.wait(guard, [this] { return !decode_queue.empty() || !running; });
+				if (!running) { return; }
+
+				auto next = std::max_element(decode_queue.begin(), decode_queue.end(), [](const DecodeJob& a, const DecodeJob& b) { return a.priority < b.priority; });
+				job = std::move(*next);
+				decode_queue.erase(next);
+			}
+
+			decode(job);
+
+			std::lock_guard<std::mutex> guard(lock);
+			decoded.push_back(std::move(job));
+		}
+	}
+
+	//Finest level worth having for the screen size, the coarsest level while the texture is not on screen
+	int wantedLevel(const Stream& stream)
+	{
+		if (full_detail || stream.pinned) { return 0; }
+		if (stream.screen_size <= 0.f) { return stream.levels - 1; }
+
+		float texels = (float)std::max(stream.width, stream.height);
+		int level = (int)floor(log2(texels / (stream.screen_size * DETAIL_SCALE)));
+		return glm::clamp(level, 0, stream.levels - 1);
+	}
+
+	void collectDecoded()
+	{
+		std::vector<DecodeJob> finished;
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			finished.swap(decoded);
+		}
+
+		for (DecodeJob& job : finished)
+		{
+			Stream& stream = streams[job.stream];
+			stream.decoding = false;
+			if (job.pixels.empty())
+			{
+				std::cerr << "Error: " << job.error << std::endl;
+				stream.failed = true;
+				continue;
+			}
+			stream.pixels = std::move(job.pixels);
+			stream.finest_decoded = job.finest;
+			stream.face = stream.row = 0;
+		}
+	}
+
+	//Picks up this frame's screen sizes and asks the decode thread for levels that are not there yet
+	void queueDecodes()
+	{
+		std::lock_guard<std::mutex> guard(lock);
+		for (unsigned int i = 0; i < streams.size(); i++)
+		{
+			Stream& stream = streams[i];
+			stream.wanted = wantedLevel(stream);
+			stream.priority = (full_detail || stream.pinned) ? FLT_MAX : stream.screen_size;
+			stream.screen_size = 0.f;
+
+			//Levels already decoded are uploaded even when the texture shrank on screen meanwhile, so moving back and forth does not decode again
+			if (stream.failed || stream.decoding || stream.wanted >= stream.resident) { continue; }
+			if (!stream.pixels.empty() && stream.finest_decoded <= stream.wanted) { continue; }
+
+			DecodeJob job;
+			job.stream = i;
+			job.paths = stream.paths;
+			job.flip = stream.flip;
+			job.width = stream.width;
+			job.height = stream.height;
+			job.channels = stream.channels;
+			job.levels = stream.levels;
+			job.finest = stream.wanted;
+			job.coarsest = stream.resident - 1; //Restarts the level being uploaded, rather than keeping two partial copies around
+			job.priority = stream.priority;
+			decode_queue.push_back(std::move(job));
+
+			stream.decoding = true;
+			stream.pixels.clear();
+		}
+
+		for (DecodeJob& job : decode_queue) { job.priority = streams[job.stream].priority; }
+		if (!decode_queue.empty()) { wake.notify_one(); }
+	}
+
+	//Copies bands of rows into the next staging buffer, largest textures on screen first, then uploads them from it
+	size_t uploadBands()
+	{
+		std::vector<unsigned int> order;
+		for (unsigned int i = 0; i < streams.size(); i++)
+		{
+			if (!streams[i].pixels.empty()) { order.push_back(i); }
+		}
+		if (order.empty()) { return 0; }
+		std::stable_sort(order.begin(), order.end(), [this](unsigned int a, unsigned int b) { return streams[a].priority > streams[b].priority; });
+
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging[next_staging]);
+		next_staging = (next_staging + 1) % PBO_COUNT;
+		unsigned char* mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, STAGING_BYTES, GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT);
+		if (!mapped)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+			return 0;
+		}
+
+		struct Band
+		{
+			Stream* stream;
+			int level, face, row, rows;
+			size_t offset;
+			bool completes_level;
+		};
+		std::vector<Band> bands;
+		size_t used = 0;
+
+		for (unsigned int index : order)
+		{
+			Stream& stream = streams[index];
+			while (!stream.pixels.empty())
+			{
+				int level = stream.resident - 1;
+				int width = levelSize(stream.width, level), height = levelSize(stream.height, level);
+				size_t row_bytes = (size_t)width * stream.channels;
+				int rows = std::min(height - stream.row, (int)((STAGING_BYTES - used) / row_bytes));
+				if (rows <= 0) { break; }
+
+				std::vector<unsigned char>& source = stream.pixels[level * stream.faces() + stream.face];
+				memcpy(mapped + used, source.data() + stream.row * row_bytes, rows * row_bytes);
+				Band band = { &stream, level, stream.face, stream.row, rows, used, false };
+				used += rows * row_bytes;
+
+				stream.row += rows;
+				if (stream.row == height)
+				{
+					std::vector<unsigned char>().swap(source);
+					stream.row = 0;
+					if (++stream.face == stream.faces())
+					{
+						stream.face = 0;
+						stream.resident = level;
+						band.completes_level = true;
+						if (level == stream.finest_decoded) { stream.pixels.clear(); }
+					}
+				}
+				bands.push_back(band);
+			}
+			if (used == STAGING_BYTES) { break; }
+		}
+		glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+		glActiveTexture(GL_TEXTURE0);
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+		for (const Band& band : bands)
+		{
+			const Stream& stream = *band.stream;
+			glBindTexture(stream.target, stream.texture);
+			glTexSubImage2D(faceTarget(stream, band.face), band.level, 0, band.row, levelSize(stream.width, band.level), band.rows,
+				pixelFormat(stream.channels), GL_UNSIGNED_BYTE, (const void*)band.offset);
+			if (band.completes_level) { glTexParameteri(stream.target, GL_TEXTURE_BASE_LEVEL, band.level); }
+		}
+		glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		uploaded_bytes += used;
+		last_upload_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+		return used;
+	}
+
+	unsigned int createStream(GLenum target, const std::string& name, const std::vector<std::string>& paths, bool flip,
+		int width, int height, int channels, Placeholder placeholder, bool pinned)
+	{
+		Stream stream;
+		stream.target = target;
+		stream.name = name;
+		stream.paths = paths;
+		stream.flip = flip;
+		stream.pinned = pinned;
+		stream.width = width;
+		stream.height = height;
+		stream.channels = channels;
+		stream.levels = mipLevels(width, height);
+		stream.resident = stream.levels;
+		stream.wanted = wantedLevel(stream);
+
+		glGenTextures(1, &stream.texture);
+		glActiveTexture(GL_TEXTURE0);
+		glBindTexture(target, stream.texture);
+		debug_output.Label(GL_TEXTURE, stream.texture, name);
+		glTexStorage2D(target, stream.levels, internalFormat(channels), width, height);
+		memory_tracker.Allocate(GL_TEXTURE, stream.texture, MemoryTracker::TEXTURE, name,
+			MemoryTracker::TextureBytes(width, height, channels == 3 ? 4 : channels, true) * stream.faces());
+
+		//The coarsest level is 1x1, it holds the placeholder until the real level replaces it
+		static const unsigned char texels[3][4] = { { 128, 128, 128, 255 }, { 0, 0, 0, 255 }, { 128, 128, 255, 255 } };
+		for (int face = 0; face < stream.faces(); face++)
+		{
+			glTexSubImage2D(faceTarget(stream, face), stream.levels - 1, 0, 0, 1, 1, pixelFormat(channels), GL_UNSIGNED_BYTE, texels[placeholder]);
+		}
+		glTexParameteri(target, GL_TEXTURE_BASE_LEVEL, stream.levels - 1);
+
+		GLenum wrap = target == GL_TEXTURE_CUBE_MAP ? GL_CLAMP_TO_EDGE : GL_REPEAT;
+		glTexParameteri(target, GL_TEXTURE_WRAP_S, wrap);
+		glTexParameteri(target, GL_TEXTURE_WRAP_T, wrap);
+		glTexParameteri(target, GL_TEXTURE_WRAP_R, wrap);
+		glTexParameteri(target, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+		glTexParameteri(target, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+
+		stream_index[stream.texture] = streams.size();
+		streams.push_back(stream);
+		return stream.texture;
+	}
+
+public:
+	~TextureStreamer()
+	{
+		Shutdown();
+	}
+
+	//Needs a current context
+	bool Initialize()
+	{
+		glGenBuffers(PBO_COUNT, staging);
+		for (int i = 0; i < PBO_COUNT; i++)
+		{
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, staging[i]);
+			glBufferData(GL_PIXEL_UNPACK_BUFFER, STAGING_BYTES, NULL, GL_STREAM_DRAW);
+			debug_output.Label(GL_BUFFER, staging[i], "Texture Streaming Staging");
+			memory_tracker.Allocate(GL_BUFFER, staging[i], MemoryTracker::STAGING_BUFFER, "Texture Streaming", STAGING_BYTES);
+		}
+		glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+
+		start_time = std::chrono::steady_clock::now();
+		running = true;
+		decoder = std::thread(&TextureStreamer::decodeLoop, this);
+		return true;
+	}
+
+	void Shutdown()
+	{
+		{
+			std::lock_guard<std::mutex> guard(lock);
+			running = false;
+		}
+		wake.notify_all();
+		if (decoder.joinable()) { decoder.join(); }
+	}
+
+	//Everything is uploaded at full detail, regardless of screen size
+	void setFullDetail(bool enabled)
+	{
+		full_detail = enabled;
+	}
+
+	//Returns the texture straight away, only the image header is read here. 0 when the file cannot be read.
+	unsigned int Load2D(const std::string& path, bool flip, Placeholder placeholder, bool pinned = false)
+	{
+		int width, height, components;
+		if (!stbi_info(path.c_str(), &width, &height, &components))
+		{
+			std::cout << "Texture failed to load at path: " << path << std::endl;
+			return 0;
+		}
+		return createStream(GL_TEXTURE_2D, path, { path }, flip, width, height, components, placeholder, pinned);
+	}
+
+	//Faces in GL_TEXTURE_CUBE_MAP_POSITIVE_X order, all square and the same size. Always streamed to full detail.
+	unsigned int LoadCubeMap(const std::vector<std::string>& faces, const std::string& name)
+	{
+		int width = 0, height = 0, components;
+		for (unsigned int i = 0; i < faces.size(); i++)
+		{
+			int face_width, face_height;
+			if (!stbi_info(faces[i].c_str(), &face_width, &face_height, &components) || face_width != face_height || (i > 0 && face_width != width))
+			{
+				std::cerr << "Failed to Load Cube Map Texture! " << faces[i] << std::endl;
+				return 0;
+			}
+			width = face_width;
+			height = face_height;
+		}
+		if (faces.size() != 6)
+		{
+			std::cerr << "Failed to Load Cube Map Texture! Expected 6 faces, got " << faces.size() << std::endl;
+			return 0;
+		}
+		return createStream(GL_TEXTURE_CUBE_MAP, name, faces, false, width, height, 3, BLACK, true);
+	}
+
+	//Diameter in pixels the texture is drawn at this frame, the largest hint wins. Textures without a hint drop to the coarsest level.
+	void setScreenSize(unsigned int texture, float pixels)
+	{
+		auto stream = stream_index.find(texture);
+		if (stream == stream_index.end()) { return; }
+		streams[stream->second].screen_size = std::max(streams[stream->second].screen_size, pixels);
+	}
+
+	//Call once per frame after the screen sizes are set, before drawing
+	void Update()
+	{
+		if (streams.empty()) { return; }
+		collectDecoded();
+		queueDecodes();
+		uploadBands();
+	}
+
+	//Blocks until every texture is at the level it last asked for
+	void Flush()
+	{
+		while (isStreaming())
+		{
+			Update();
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	//True while decodes or uploads are outstanding
+	bool isStreaming()
+	{
+		for (const Stream& stream : streams)
+		{
+			if (!stream.failed && (stream.decoding || !stream.pixels.empty() || stream.resident > stream.wanted)) { return true; }
+		}
+		return false;
+	}
+
+	size_t getUploadedBytes()
+	{
+		return uploaded_bytes;
+	}
+
+	//Milliseconds from Initialize to the most recent upload
+	double getLastUploadTime()
+	{
+		return last_upload_ms;
+	}
+};
+
+TextureStreamer texture_streamer;
+
+#endif
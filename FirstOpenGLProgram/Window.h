@@ -3,21 +3,68 @@
 #define WINDOW_H
 
 #include "Main_Header.h"
+#include "Debug_Output.h"
+#include "Memory_Tracker.h"
 
 class Window
 {
 private:
 	GLFWwindow* gWindow;
 
+	//Headless rendering has no visible window, frames end up in an offscreen back buffer instead
+	bool headless = false;
+	int headless_width = 0;
+	int headless_height = 0;
+	unsigned int backFBO = 0;
+	unsigned int backColorBuffer = 0;
+	unsigned int backDepthBuffer = 0;
+
+	void createBackBuffer()
+	{
+		glGenFramebuffers(1, &backFBO);
+		glBindFramebuffer(GL_FRAMEBUFFER, backFBO);
+
+		glGenRenderbuffers(1, &backColorBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, backColorBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, headless_width, headless_height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, backColorBuffer);
+
+		glGenRenderbuffers(1, &backDepthBuffer);
+		glBindRenderbuffer(GL_RENDERBUFFER, backDepthBuffer);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, headless_width, headless_height);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, backDepthBuffer);
+
+		debug_output.Label(GL_FRAMEBUFFER, backFBO, "Headless Back Buffer FBO");
+		debug_output.Label(GL_RENDERBUFFER, backColorBuffer, "Headless Back Buffer Color");
+		debug_output.Label(GL_RENDERBUFFER, backDepthBuffer, "Headless Back Buffer Depth Stencil");
+		memory_tracker.Allocate(GL_RENDERBUFFER, backColorBuffer, MemoryTracker::RENDER_TARGET, "Headless Back Buffer", MemoryTracker::TextureBytes(headless_width, headless_height, 4, false));
+		memory_tracker.Allocate(GL_RENDERBUFFER, backDepthBuffer, MemoryTracker::RENDER_TARGET, "Headless Back Buffer", MemoryTracker::TextureBytes(headless_width, headless_height, 4, false));
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+		{
+			std::cout << "Headless back buffer not complete!" << std::endl;
+		}
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		glViewport(0, 0, headless_width, headless_height);
+	}
+
 public:
 	Window()
 	{
 		gWindow = NULL;
 	}
 
-	Window(const char* name, int* width, int* height)
+	Window(const char* name, int* width, int* height, bool headless = false)
 	{
 		gWindow = NULL;
+		this->headless = headless;
+		headless_width = *width;
+		headless_height = *height;
+
+		if (headless)
+		{ //No display server, GLFW's null platform with an OSMesa (llvmpipe) context renders on the CPU
+			glfwInitHint(GLFW_PLATFORM, GLFW_PLATFORM_NULL);
+		}
 
 		if (!glfwInit()) //GLFW Init Failed
 		{
@@ -32,8 +79,20 @@ public:
 		//Create Window
 		glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
 		glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 3);
+#ifdef _DEBUG
+		glfwWindowHint(GLFW_OPENGL_DEBUG_CONTEXT, GLFW_TRUE); //Reports GL errors and warnings through the debug output
+#endif
 
-		gWindow = glfwCreateWindow(glfwGetVideoMode(glfwGetPrimaryMonitor())->width, glfwGetVideoMode(glfwGetPrimaryMonitor())->height, name, glfwGetPrimaryMonitor(), NULL);
+		if (headless)
+		{
+			glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+			glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_OSMESA_CONTEXT_API);
+			gWindow = glfwCreateWindow(headless_width, headless_height, name, NULL, NULL);
+		}
+		else
+		{
+			gWindow = glfwCreateWindow(glfwGetVideoMode(glfwGetPrimaryMonitor())->width, glfwGetVideoMode(glfwGetPrimaryMonitor())->height, name, glfwGetPrimaryMonitor(), NULL);
+		}
 
 		if (!gWindow) //Window Failed
 		{
@@ -48,6 +107,15 @@ public:
 
 	~Window()
 	{
+		if (backFBO != 0)
+		{
+			memory_tracker.Free(GL_RENDERBUFFER, backColorBuffer);
+			memory_tracker.Free(GL_RENDERBUFFER, backDepthBuffer);
+			glDeleteFramebuffers(1, &backFBO);
+			glDeleteRenderbuffers(1, &backColorBuffer);
+			glDeleteRenderbuffers(1, &backDepthBuffer);
+		}
+
 		glfwDestroyWindow(gWindow);
 		gWindow = NULL;
 		glfwTerminate();
@@ -55,23 +123,42 @@ public:
 
 	bool Initialize()
 	{
-		if (glewInit() != GLEW_OK) //Initialize GLEW Libraries
+		glewExperimental = GL_TRUE;
+		GLenum glew_status = glewInit();
+
+		if (glew_status != GLEW_OK) //Initialize GLEW Libraries
 		{
 			printf("GLEW Initialization: Failed!\n");
+			if (headless && glew_status == GLEW_ERROR_NO_GLX_DISPLAY)
+			{ //A GLX build of GLEW gives up here without loading a single entry point, every gl* call would go through NULL
+				printf("Headless rendering needs GLEW built with GLEW_OSMESA, which loads entry points through OSMesaGetProcAddress\n");
+			}
 			exit(EXIT_FAILURE);
 		}
 		printf("GLEW Initialization: Succeeded!\n");
-		glfwSwapInterval(1);
+
+		debug_output.Initialize();
+
+		if (headless)
+		{
+			if (backFBO == 0) { createBackBuffer(); }
+		}
+		else
+		{
+			glfwSwapInterval(1);
+		}
 
 		return true;
 	}
 
 	int getWindowWidth()
 	{
+		if (headless) { return headless_width; }
 		return glfwGetVideoMode(glfwGetPrimaryMonitor())->width;
 	}
 	int getWindowHeight()
 	{
+		if (headless) { return headless_height; }
 		return glfwGetVideoMode(glfwGetPrimaryMonitor())->height;
 	}
 
@@ -80,9 +167,47 @@ public:
 		return gWindow;
 	}
 
+	bool isHeadless()
+	{
+		return headless;
+	}
+
+	unsigned int getFramebuffer()
+	{ //The framebuffer that finished frames are drawn into
+		return backFBO;
+	}
+
+	bool SaveFrame(const std::string& file_path)
+	{ //Reads the finished frame back and writes it as a binary PPM image.
+		int width = getWindowWidth();
+		int height = getWindowHeight();
+		std::vector<unsigned char> pixels(width * height * 3);
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, backFBO);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, width, height, GL_RGB, GL_UNSIGNED_BYTE, &pixels[0]);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+		std::ofstream image_file(file_path, std::ios::binary);
+		if (!image_file.is_open())
+		{
+			std::cerr << "Error: Could not Open File!\n" << file_path << std::endl;
+			return false;
+		}
+
+		image_file << "P6\n" << width << " " << height << "\n255\n";
+		for (int y = height - 1; y >= 0; y--) //OpenGL rows start at the bottom
+		{
+			image_file.write((const char*)&pixels[y * width * 3], width * 3);
+		}
+		image_file.close();
+		return true;
+	}
+
 	void Swap()
 	{
-		glfwSwapBuffers(gWindow);
+		if (headless) { glFlush(); }
+		else { glfwSwapBuffers(gWindow); }
 	}
 };
 
@@ -1,10 +1,143 @@
 #include <iostream>
+#include <cstring>
+#include <climits>
 
 #include "Engine.h"
 
+void printUsage()
+{
+	std::cerr << "Options:\n"
+		"  --headless                 Render offscreen, with no window\n"
+		"  --resolution WxH           Offscreen size, needs --headless. The window is always fullscreen at the monitor's resolution\n"
+		"  --frames N                 Quit after N frames\n"
+		"  --benchmark REPORT         Fly the benchmark camera path and write a JSON report\n"
+		"  --capture FRAME FILE       Save a frame as a PPM image\n"
+		"  --deferred                 Deferred shading\n"
+		"  --depth-prepass            Depth pre-pass before the opaque models\n"
+		"  --no-shadows               Disable the sun's shadows\n"
+		"  --shadow-filter 0|1|2      Hard, medium or soft shadow edges\n"
+		"  --no-shader-cache          Always compile shaders from source\n"
+		"  --no-texture-streaming     Load every texture at full detail before the first frame\n"
+		"  --asteroids N              Asteroid instances across both belts, at least 3\n"
+		"  --vertex-probe             Time the asteroid vertex work with rasterization off\n"
+		"  --no-hot-reload            Do not watch shader files for changes\n"
+		"  --gpu-budget MS            GPU frame time dynamic resolution aims for\n"
+		"  --no-dynamic-resolution    Always render at the window's resolution\n"
+		"  --supersample              Let dynamic resolution go up to 1.5x when under budget, the scene targets take 2.25x the memory\n"
+		"  --vram-budget MB           Warn once tracked GPU memory goes over this\n";
+}
+
 int main(int argc, char** argv)
 {
 	Engine* engine = new Engine("OpenGL Solar System", 800, 600);
+	bool headless = false;
+	bool resolution = false;
+
+	//Command Line Options
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--headless") == 0)
+		{
+			engine->setHeadless(true);
+			headless = true;
+		}
+		else if (strcmp(argv[i], "--resolution") == 0 && i + 1 < argc)
+		{ //Headless only, checked once every option is read
+			int width, height;
+			char end;
+			if (sscanf(argv[++i], "%dx%d%c", &width, &height, &end) != 2 || width <= 0 || height <= 0)
+			{
+				std::cerr << "--resolution expects WIDTHxHEIGHT, got " << argv[i] << std::endl;
+				printUsage();
+				delete engine;
+				return 1;
+			}
+			engine->setResolution(width, height);
+			resolution = true;
+		}
+		else if (strcmp(argv[i], "--frames") == 0 && i + 1 < argc)
+		{
+			engine->setFrameLimit(atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--benchmark") == 0 && i + 1 < argc)
+		{
+			engine->setBenchmark(argv[++i]);
+		}
+		else if (strcmp(argv[i], "--capture") == 0 && i + 2 < argc)
+		{
+			int frame = atoi(argv[++i]);
+			engine->setCaptureFrame(frame, argv[++i]);
+		}
+		else if (strcmp(argv[i], "--deferred") == 0)
+		{
+			engine->setDeferred(true);
+		}
+		else if (strcmp(argv[i], "--depth-prepass") == 0)
+		{
+			engine->setDepthPrepass(true);
+		}
+		else if (strcmp(argv[i], "--no-shadows") == 0)
+		{
+			engine->setShadows(false);
+		}
+		else if (strcmp(argv[i], "--shadow-filter") == 0 && i + 1 < argc)
+		{ //0 hard, 1 medium, 2 soft
+			engine->setShadowFilter(atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--no-shader-cache") == 0)
+		{ //Always compile from source, for measuring cold startup
+			engine->setShaderCache(false);
+		}
+		else if (strcmp(argv[i], "--no-texture-streaming") == 0)
+		{ //Load every texture at full detail before the first frame
+			engine->setTextureStreaming(false);
+		}
+		else if (strcmp(argv[i], "--asteroids") == 0 && i + 1 < argc)
+		{ //Instances across both belts, chunks outside the view are culled so dense belts stay cheap
+			char* end;
+			unsigned long count = strtoul(argv[++i], &end, 10);
+			if (end == argv[i] || *end != '\0' || argv[i][0] == '-')
+			{
+				std::cerr << "--asteroids expects a positive number, got " << argv[i] << std::endl;
+				printUsage();
+				delete engine;
+				return 1;
+			}
+			engine->setAsteroidCount((unsigned int)std::min(count, (unsigned long)UINT_MAX));
+		}
+		else if (strcmp(argv[i], "--vertex-probe") == 0)
+		{ //Draws the asteroid belts a second time with rasterization off to time their vertex work alone
+			engine->setVertexProbe(true);
+		}
+		else if (strcmp(argv[i], "--no-hot-reload") == 0)
+		{
+			engine->setHotReload(false);
+		}
+		else if (strcmp(argv[i], "--gpu-budget") == 0 && i + 1 < argc)
+		{ //GPU milliseconds per frame that dynamic resolution aims for
+			engine->setGpuBudget((float)atof(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--no-dynamic-resolution") == 0)
+		{
+			engine->setDynamicResolution(false);
+		}
+		else if (strcmp(argv[i], "--supersample") == 0)
+		{ //Scene targets are allocated at 1.5x the screen so the scale has room above 1
+			engine->setSupersampling(true);
+		}
+		else if (strcmp(argv[i], "--vram-budget") == 0 && i + 1 < argc)
+		{ //In megabytes, a warning is printed the first time tracked allocations go over it
+			memory_tracker.setBudget((size_t)atoi(argv[++i]) * 1024 * 1024);
+		}
+	}
+
+	if (resolution && !headless)
+	{
+		std::cerr << "--resolution only applies with --headless, the window is always fullscreen at the monitor's resolution" << std::endl;
+		printUsage();
+		delete engine;
+		return 1;
+	}
 
 	if (!engine->Initialize())
 	{
@@ -19,4 +152,4 @@ int main(int argc, char** argv)
 	engine = NULL;
 
 	return 0;
-}
\ No newline at end of file
+}